@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/range/algorithm/remove_if.hpp>
+
+#include "baldr/datetime.h"
+#include "baldr/graphconstants.h"
+#include "timing.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// The date the way get_formatted_date used to parse it
+boost::gregorian::date boost_date(const std::string& date) {
+  std::string dt = date;
+  dt.erase(boost::remove_if(dt, boost::is_any_of("-,:")), dt.end());
+  return boost::gregorian::date_from_iso_string(dt);
+}
+
+// The seconds the way seconds_from_midnight used to parse them
+uint32_t boost_seconds(const std::string& date_time) {
+  return boost::posix_time::duration_from_string(
+      date_time.substr(date_time.find("T") + 1)).total_seconds();
+}
+
+// The check the way is_iso_local used to do it
+bool boost_iso_local(const std::string& date_time) {
+  try {
+    std::stringstream ss;
+    auto* input_facet = new boost::local_time::local_time_input_facet("%Y-%m-%dT%H:%M");
+    ss.imbue(std::locale(ss.getloc(), input_facet));
+    boost::posix_time::ptime pt;
+    ss.str(date_time);
+    return static_cast<bool>(ss >> pt) && std::stoi(date_time.substr(11, 2)) <= 23 &&
+           std::stoi(date_time.substr(14)) <= 59;
+  } catch (std::exception& e) {
+    return false;
+  }
+}
+
+}
+
+// Compares parsing YYYY-MM-DDTHH:MM strings for their date, seconds from
+// midnight, day of week and validity with boost against parse_date_time.
+// usage: date_time_parse [strings] [iterations]
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::atoi(argv[1]) : 100000;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> years(2014, 2030), months(1, 12), days(1, 28),
+      hours(0, 23), minutes(0, 59);
+  std::vector<std::string> date_times(count);
+  for (auto& date_time : date_times) {
+    char text[32];
+    snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d", years(generator), months(generator),
+             days(generator), hours(generator), minutes(generator));
+    date_time = text;
+  }
+
+  int64_t boost_dates = 0, dates = 0, boost_secs = 0, secs = 0, boost_dows = 0, dows = 0,
+    boost_valid = 0, valid = 0;
+  double boost_date_ms = bench::time_passes(iterations, boost_dates, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += boost_date(date_time).day_number();
+    return total;
+  });
+  double date_ms = bench::time_passes(iterations, dates, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += DateTime::get_formatted_date(date_time).day_number();
+    return total;
+  });
+  double boost_seconds_ms = bench::time_passes(iterations, boost_secs, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += boost_seconds(date_time);
+    return total;
+  });
+  double seconds_ms = bench::time_passes(iterations, secs, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += DateTime::seconds_from_midnight(date_time);
+    return total;
+  });
+  double boost_dow_ms = bench::time_passes(iterations, boost_dows, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += 1 << boost_date(date_time).day_of_week().as_number();
+    return total;
+  });
+  double dow_ms = bench::time_passes(iterations, dows, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += DateTime::day_of_week_mask(date_time);
+    return total;
+  });
+  double boost_valid_ms = bench::time_passes(iterations, boost_valid, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += boost_iso_local(date_time);
+    return total;
+  });
+  double valid_ms = bench::time_passes(iterations, valid, [&]() {
+    int64_t total = 0;
+    for (const auto& date_time : date_times)
+      total += DateTime::is_iso_local(date_time);
+    return total;
+  });
+
+  if (boost_dates != dates || boost_secs != secs || boost_dows != dows || boost_valid != valid) {
+    std::cerr << "Parsers disagree" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << count << " date times, boost vs parse_date_time:" << std::endl;
+  std::cout << "  get_formatted_date " << boost_date_ms << " ms vs " << date_ms << " ms" << std::endl;
+  std::cout << "  seconds_from_midnight " << boost_seconds_ms << " ms vs " << seconds_ms << " ms" << std::endl;
+  std::cout << "  day_of_week_mask " << boost_dow_ms << " ms vs " << dow_ms << " ms" << std::endl;
+  std::cout << "  is_iso_local " << boost_valid_ms << " ms vs " << valid_ms << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
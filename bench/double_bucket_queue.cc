@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "baldr/bucket_queue.h"
+#include "baldr/double_bucket_queue.h"
+#include "search.h"
+
+using namespace valhalla::baldr;
+using namespace bench;
+
+// Compares DoubleBucketQueue decrease by scanning the previous bucket, its
+// lazy decrease, an adaptive DoubleBucketQueue and the templated BucketQueue
+// reused across searches
+// usage: double_bucket_queue [grid dimension] [iterations]
+int main(int argc, char** argv) {
+  uint32_t dim = argc > 1 ? std::atoi(argv[1]) : 500;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+  grid_t grid(dim, 42);
+  labels_t labels(dim * dim);
+  const auto labelcost = [&labels](const uint32_t label) {
+    return labels.costs[label];
+  };
+
+  for (uint32_t bucketsize : {1, 10, 60}) {
+    result_t s{}, l{}, b{}, a{};
+    double scan = time_passes(iterations, s, [&]() {
+      DoubleBucketQueue adjlist(0, 14400, bucketsize, labelcost);
+      return dijkstra(grid, labels, adjlist);
+    });
+    double lazy = time_passes(iterations, l, [&]() {
+      DoubleBucketQueue adjlist(0, 14400, bucketsize, labelcost, true);
+      return dijkstra(grid, labels, adjlist);
+    });
+    BucketQueue<uint32_t, label_cost_t> queue(0, 14400, bucketsize, label_cost_t{&labels.costs});
+    double bucket = time_passes(iterations, b, [&]() {
+      queue.clear();
+      return dijkstra(grid, labels, queue);
+    });
+
+    // An adaptive queue starting with a range of 30 minutes, reused
+    DoubleBucketQueue adaptive(0, 1800, bucketsize, labelcost, true, bucketsize * 4);
+    double adapt = time_passes(iterations, a, [&]() {
+      adaptive.clear();
+      return dijkstra(grid, labels, adaptive);
+    });
+    if (s.settled != l.settled || s.maxcost != l.maxcost ||
+        s.settled != b.settled || s.maxcost != b.maxcost || s.settled != a.settled) {
+      std::cerr << "Queues settled different trees" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "bucketsize " << bucketsize << ": " << s.settled << " labels, "
+              << s.decreases << " decreases, scan " << scan << " ms, lazy "
+              << lazy << " ms, BucketQueue " << bucket << " ms, adaptive " << adapt
+              << " ms" << std::endl;
+    const auto& stats = adaptive.stats();
+    std::cout << "  adaptive: range " << adaptive.range() << ", bucketsize "
+              << adaptive.bucketsize() << ", " << stats.range_shifts << " range shifts, "
+              << stats.overflow_scans << " overflow scans, " << stats.stale
+              << " stale, " << stats.resizes << " resizes" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
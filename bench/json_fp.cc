@@ -0,0 +1,71 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "baldr/json.h"
+#include "timing.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// Times writing all the values to a fresh stream, returns the total in ms
+template <typename write_t>
+double time_writes(const std::vector<json::fp_t>& values, std::string& text, const write_t& write) {
+  return bench::time_passes(1, text, [&]() {
+    std::stringstream stream;
+    for (const auto& value : values) {
+      write(stream, value);
+      stream << ',';
+    }
+    return stream.str();
+  });
+}
+
+}
+
+// Compares writing json::fp_t coordinates through iostream's std::fixed, the
+// way operator<< used to, against json::to_chars and the StreamWriter
+// usage: json_fp [coordinates] [precision]
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  size_t precision = argc > 2 ? std::atoi(argv[2]) : 6;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> lon(-180, 180), lat(-90, 90);
+  std::vector<json::fp_t> values;
+  values.reserve(count * 2);
+  for (size_t i = 0; i < count; ++i) {
+    values.push_back({lon(generator), precision});
+    values.push_back({lat(generator), precision});
+  }
+
+  std::string fixed_text, chars_text;
+  double fixed = time_writes(values, fixed_text, [](std::ostream& stream, const json::fp_t& fp) {
+    stream << std::setprecision(fp.precision) << std::fixed << fp.value;
+  });
+  double chars = time_writes(values, chars_text, [](std::ostream& stream, const json::fp_t& fp) {
+    stream << fp;
+  });
+
+  size_t streamed_size = 0;
+  double streamed = bench::time_passes(1, streamed_size, [&values]() {
+    json::StreamWriter writer(values.size() * 12);
+    writer.start_array();
+    for (const auto& value : values)
+      writer.value(value);
+    writer.end_array();
+    return writer.str().size();
+  });
+
+  if (fixed_text != chars_text) {
+    std::cerr << "Formatting differs from std::fixed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << values.size() << " values at precision " << precision << ": std::fixed "
+            << fixed << " ms, to_chars " << chars << " ms, StreamWriter " << streamed
+            << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/json_reader.h"
+#include "baldr/location.h"
+#include "timing.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// A matrix style request body with an array of locations
+std::string make_locations(const size_t count) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> lon(-180, 180), lat(-90, 90);
+  std::stringstream json;
+  json.precision(9);
+  json << "{\"locations\":[";
+  for (size_t i = 0; i < count; ++i) {
+    json << (i ? "," : "") << "{\"lat\":" << lat(generator) << ",\"lon\":" << lon(generator)
+         << ",\"type\":\"" << (i % 2 ? "break" : "through") << "\",\"heading\":" << i % 360
+         << ",\"name\":\"location " << i << "\"}";
+  }
+  json << "],\"costing\":\"auto\"}";
+  return json.str();
+}
+
+}
+
+// Compares parsing the locations of a request with a property tree and
+// Location::FromPtree against the json reader and Location::FromJsonArray
+// usage: location_json [locations] [iterations]
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::atoi(argv[1]) : 5000;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+  std::string request = make_locations(count);
+
+  std::vector<Location> ptree_locations, reader_locations;
+  double ptree = bench::time_passes(iterations, ptree_locations, [&request]() {
+    std::stringstream stream(request);
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(stream, pt);
+    std::vector<Location> locations;
+    for (const auto& location : pt.get_child("locations"))
+      locations.push_back(Location::FromPtree(location.second));
+    return locations;
+  });
+  double reader = bench::time_passes(iterations, reader_locations, [&request]() {
+    json::Reader reader(request);
+    std::vector<Location> locations;
+    reader.start_map();
+    json::Slice key;
+    while (reader.next_key(key)) {
+      if (key == "locations")
+        locations = Location::FromJsonArray(reader);
+      else
+        reader.skip();
+    }
+    reader.finish();
+    return locations;
+  });
+
+  if (ptree_locations != reader_locations) {
+    std::cerr << "Parsed different locations" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << count << " locations (" << request.size() << " bytes): ptree " << ptree
+            << " ms, json reader " << reader << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+#include "baldr/bucket_queue.h"
+#include "baldr/double_bucket_queue.h"
+#include "baldr/radix_heap.h"
+#include "search.h"
+
+using namespace valhalla::baldr;
+using namespace bench;
+
+namespace {
+
+// std::priority_queue with the add/decrease/pop interface of the bucket
+// queues. Decreased labels are pushed again and skipped when their cost no
+// longer matches.
+class priority_queue_t {
+ public:
+  priority_queue_t(const std::vector<float>& costs): costs(costs) { }
+  void add(const uint32_t label, const float cost) {
+    queue.emplace(cost, label);
+  }
+  void decrease(const uint32_t label, const float newcost, const float) {
+    queue.emplace(newcost, label);
+  }
+  uint32_t pop() {
+    while (!queue.empty()) {
+      auto top = queue.top();
+      queue.pop();
+      if (costs[top.second] == top.first)
+        return top.second;
+    }
+    return kInvalidLabel;
+  }
+ private:
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+  const std::vector<float>& costs;
+};
+
+}
+
+// Compares DoubleBucketQueue (lazy decrease), BucketQueue, RadixHeap and
+// std::priority_queue across ranges of edge costs. The bucket queues use
+// 1 second buckets over a 4 hour range.
+// usage: priority_queues [grid dimension] [iterations]
+int main(int argc, char** argv) {
+  uint32_t dim = argc > 1 ? std::atoi(argv[1]) : 500;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+  labels_t labels(dim * dim);
+  const auto labelcost = [&labels](const uint32_t label) {
+    return labels.costs[label];
+  };
+
+  const std::pair<float, float> ranges[] = { {1, 10}, {5, 120}, {60, 3600} };
+  for (const auto& range : ranges) {
+    grid_t grid(dim, 42, range.first, range.second);
+    result_t d{}, b{}, r{}, p{};
+    double dbq = time_passes(iterations, d, [&]() {
+      DoubleBucketQueue adjlist(0, 14400, 1, labelcost, true);
+      return dijkstra(grid, labels, adjlist);
+    });
+    BucketQueue<uint32_t, label_cost_t> bucketqueue(0, 14400, 1, label_cost_t{&labels.costs});
+    double bq = time_passes(iterations, b, [&]() {
+      bucketqueue.clear();
+      return dijkstra(grid, labels, bucketqueue);
+    });
+    RadixHeap<uint32_t, label_cost_t> radixheap(label_cost_t{&labels.costs});
+    double rh = time_passes(iterations, r, [&]() {
+      radixheap.clear();
+      return dijkstra(grid, labels, radixheap);
+    });
+    double pq = time_passes(iterations, p, [&]() {
+      priority_queue_t adjlist(labels.costs);
+      return dijkstra(grid, labels, adjlist);
+    });
+
+    // The radix heap and priority queue are exact, the bucket queues only
+    // order labels to within a bucket
+    if (d.settled != p.settled || b.settled != p.settled ||
+        r.settled != p.settled || r.maxcost != p.maxcost) {
+      std::cerr << "Queues settled different trees" << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "edge costs [" << range.first << ", " << range.second << "): "
+              << p.settled << " labels, max cost " << p.maxcost
+              << ", DoubleBucketQueue " << dbq << " ms, BucketQueue " << bq
+              << " ms, RadixHeap " << rh << " ms, std::priority_queue " << pq
+              << " ms" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
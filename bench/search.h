@@ -0,0 +1,94 @@
+#ifndef VALHALLA_BENCH_SEARCH_H_
+#define VALHALLA_BENCH_SEARCH_H_
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "baldr/double_bucket_queue.h"
+#include "timing.h"
+
+// Helpers shared by the priority queue benchmarks: a random grid graph and
+// a label setting search over it that is templated on the queue.
+namespace bench {
+
+using valhalla::baldr::kInvalidLabel;
+
+// A grid graph with random edge costs standing in for a road network. Each
+// node connects to its 4 neighbors, edge costs are in [mincost, maxcost).
+struct grid_t {
+  grid_t(const uint32_t dim, const uint32_t seed, const float mincost = 5.0f,
+         const float maxcost = 120.0f): dim(dim), costs(dim * dim * 4) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(mincost, maxcost);
+    for (auto& c : costs)
+      c = dist(gen);
+  }
+  uint32_t dim;
+  std::vector<float> costs;
+};
+
+struct result_t {
+  uint32_t settled;
+  uint32_t decreases;
+  float maxcost;
+};
+
+// Costs and settled flags of the labels, the labels are the node indexes
+struct labels_t {
+  labels_t(const uint32_t count): costs(count), settled(count) { }
+  std::vector<float> costs;
+  std::vector<bool> settled;
+};
+
+// Label cost functor for BucketQueue
+struct label_cost_t {
+  const std::vector<float>* costs;
+  float operator()(const uint32_t label) const {
+    return (*costs)[label];
+  }
+};
+
+// Dijkstra from the center of the grid
+template <typename queue_t>
+result_t dijkstra(const grid_t& grid, labels_t& labels, queue_t& adjlist) {
+  std::fill(labels.costs.begin(), labels.costs.end(), std::numeric_limits<float>::max());
+  std::fill(labels.settled.begin(), labels.settled.end(), false);
+  result_t result{0, 0, 0};
+  uint32_t origin = labels.costs.size() / 2 + grid.dim / 2;
+  labels.costs[origin] = 0;
+  adjlist.add(origin, 0);
+  for (uint32_t label = adjlist.pop(); label != kInvalidLabel; label = adjlist.pop()) {
+    labels.settled[label] = true;
+    result.settled++;
+    result.maxcost = labels.costs[label];
+    uint32_t x = label % grid.dim, y = label / grid.dim;
+    const uint32_t neighbors[] = {
+      x > 0 ? label - 1 : kInvalidLabel,
+      x + 1 < grid.dim ? label + 1 : kInvalidLabel,
+      y > 0 ? label - grid.dim : kInvalidLabel,
+      y + 1 < grid.dim ? label + grid.dim : kInvalidLabel
+    };
+    for (uint32_t i = 0; i < 4; ++i) {
+      uint32_t n = neighbors[i];
+      if (n == kInvalidLabel || labels.settled[n])
+        continue;
+      float cost = labels.costs[label] + grid.costs[label * 4 + i];
+      if (labels.costs[n] == std::numeric_limits<float>::max()) {
+        labels.costs[n] = cost;
+        adjlist.add(n, cost);
+      } else if (cost < labels.costs[n]) {
+        float previous = labels.costs[n];
+        labels.costs[n] = cost;
+        adjlist.decrease(n, cost, previous);
+        result.decreases++;
+      }
+    }
+  }
+  return result;
+}
+
+}
+
+#endif  // VALHALLA_BENCH_SEARCH_H_
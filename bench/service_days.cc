@@ -0,0 +1,126 @@
+#include <bitset>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "baldr/datetime.h"
+#include "baldr/graphconstants.h"
+#include "timing.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+const boost::gregorian::date pivot = DateTime::get_formatted_date(kPivotDate);
+const uint8_t dows[] = {kSunday, kMonday, kTuesday, kWednesday, kThursday, kFriday, kSaturday};
+
+// The service days the way get_service_days used to get them, a day at a time
+uint64_t iterate_days(boost::gregorian::date start_date, boost::gregorian::date end_date,
+                      const uint32_t tile_date, const uint32_t dow_mask) {
+  boost::gregorian::date tile_header_date = pivot + boost::gregorian::days(tile_date);
+  if (start_date > (tile_header_date + boost::gregorian::days(59)))
+    return 0;
+  if (start_date <= tile_header_date && tile_header_date <= end_date)
+    start_date = tile_header_date;
+  else if (tile_header_date > end_date)
+    return 0;
+  boost::gregorian::date enddate = tile_header_date + boost::gregorian::days(59);
+  if (enddate <= end_date)
+    end_date = enddate;
+  uint64_t bit_set = 0;
+  uint32_t x = 0;
+  for (boost::gregorian::day_iterator itr(tile_header_date); itr <= end_date; ++itr, ++x) {
+    if ((dow_mask & dows[(*itr).day_of_week().as_number()]) && (*itr >= start_date))
+      bit_set |= static_cast<uint64_t>(1) << x;
+  }
+  return bit_set;
+}
+
+// Service availability the way is_service_available used to check it
+bool date_period(const uint64_t days, const uint32_t start_date, const uint32_t date,
+                 const uint32_t end_date) {
+  if (start_date <= date && date <= end_date) {
+    boost::gregorian::date start = pivot + boost::gregorian::days(start_date);
+    boost::gregorian::date d = pivot + boost::gregorian::days(date);
+    boost::gregorian::date_period range(start, d);
+    return std::bitset<64>(days).test(range.length().days());
+  }
+  return false;
+}
+
+}
+
+// Compares getting the service days of transit schedules a day at a time
+// with boost's day_iterator against the masks, one at a time and as a batch,
+// and checking whether service is available on a day with boost dates
+// against shifting the mask.
+// usage: service_days [schedules] [iterations]
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::atoi(argv[1]) : 100000;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+  const uint32_t tile_date = 1000;
+
+  // Schedules around the tile date, of up to a year
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int32_t> starts(tile_date - 365, tile_date + 30);
+  std::uniform_int_distribution<int32_t> lengths(7, 365);
+  std::uniform_int_distribution<uint32_t> masks(1, 127);
+  std::vector<DateTime::service_range_t> services(count);
+  std::vector<boost::gregorian::date> start_dates(count), end_dates(count);
+  for (size_t i = 0; i < count; ++i) {
+    int32_t start = starts(generator);
+    services[i] = {start, start + lengths(generator), masks(generator)};
+    start_dates[i] = pivot + boost::gregorian::days(services[i].start_date);
+    end_dates[i] = pivot + boost::gregorian::days(services[i].end_date);
+  }
+
+  uint64_t iterated = 0, masked = 0, batched = 0;
+  double iterate = bench::time_passes(iterations, iterated, [&]() {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < count; ++i)
+      bits ^= iterate_days(start_dates[i], end_dates[i], tile_date, services[i].dow_mask);
+    return bits;
+  });
+  double mask = bench::time_passes(iterations, masked, [&]() {
+    uint64_t bits = 0;
+    for (const auto& service : services)
+      bits ^= DateTime::get_service_days(service, tile_date);
+    return bits;
+  });
+  std::vector<uint64_t> days;
+  double batch = bench::time_passes(iterations, batched, [&]() {
+    DateTime::get_service_days(services, tile_date, days);
+    uint64_t bits = 0;
+    for (auto d : days)
+      bits ^= d;
+    return bits;
+  });
+
+  // Whether each schedule runs on each of the 60 days
+  uint64_t periods = 0, shifts = 0;
+  double period = bench::time_passes(iterations, periods, [&]() {
+    uint64_t available = 0;
+    for (size_t i = 0; i < count; ++i)
+      for (uint32_t day = tile_date; day < tile_date + 60; ++day)
+        available += date_period(days[i], tile_date, day, services[i].end_date);
+    return available;
+  });
+  double shift = bench::time_passes(iterations, shifts, [&]() {
+    uint64_t available = 0;
+    for (size_t i = 0; i < count; ++i)
+      for (uint32_t day = tile_date; day < tile_date + 60; ++day)
+        available += DateTime::is_service_available(days[i], tile_date, day, services[i].end_date);
+    return available;
+  });
+
+  if (iterated != masked || masked != batched || periods != shifts) {
+    std::cerr << "Service days differ" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << count << " schedules: day_iterator " << iterate << " ms, masks " << mask
+            << " ms, batch " << batch << " ms" << std::endl;
+  std::cout << count * 60 << " availability checks: date_period " << period
+            << " ms, shift " << shift << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "baldr/datetime.h"
+#include "baldr/nodeinfo.h"
+#include "timing.h"
+
+using namespace valhalla::baldr;
+
+// Compares getting the time zone of each node from NodeInfo::timezone() by
+// looking up its region in the boost database, the way tz_db_t::from_index
+// used to, against the zones tz_db_t now resolves up front. Also compares
+// finding a region's index with a linear search against the hash, and
+// converting utc to local time with boost against the utc offset tables.
+// usage: timezone [nodes] [iterations]
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::atoi(argv[1]) : 100000;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+  const auto& tz_db = DateTime::get_tz_db();
+  const auto regions = tz_db.region_list();
+
+  // Nodes spread over every time zone
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> distribution(1, regions.size());
+  std::vector<NodeInfo> nodes(count);
+  for (auto& node : nodes)
+    node.set_timezone(distribution(generator));
+
+  int64_t looked_up = 0, resolved = 0;
+  double lookup = bench::time_passes(iterations, looked_up, [&]() {
+    int64_t offsets = 0;
+    for (const auto& node : nodes) {
+      auto tz = tz_db.time_zone_from_region(regions[node.timezone() - 1]);
+      offsets += tz->base_utc_offset().total_seconds();
+    }
+    return offsets;
+  });
+  double index = bench::time_passes(iterations, resolved, [&]() {
+    int64_t offsets = 0;
+    for (const auto& node : nodes) {
+      const auto& tz = tz_db.from_index(node.timezone());
+      offsets += tz->base_utc_offset().total_seconds();
+    }
+    return offsets;
+  });
+
+  // Region names to indices
+  std::vector<std::string> names;
+  for (size_t i = 0; i < count / 10; ++i)
+    names.push_back(regions[distribution(generator) - 1]);
+  int64_t found = 0, hashed = 0;
+  double linear = bench::time_passes(iterations, found, [&]() {
+    int64_t indices = 0;
+    for (const auto& name : names)
+      indices += std::find(regions.cbegin(), regions.cend(), name) - regions.cbegin() + 1;
+    return indices;
+  });
+  double hash = bench::time_passes(iterations, hashed, [&]() {
+    int64_t indices = 0;
+    for (const auto& name : names)
+      indices += tz_db.to_index(name);
+    return indices;
+  });
+
+  // Local time of each node at some utc time, through boost and the offsets
+  const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  std::uniform_int_distribution<int64_t> instants(1420070400, 1735689600);
+  std::vector<int64_t> utc(count);
+  for (auto& t : utc)
+    t = instants(generator);
+  int64_t boost_local = 0, table_local = 0;
+  double boost_convert = bench::time_passes(iterations, boost_local, [&]() {
+    int64_t locals = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      boost::local_time::local_date_time ldt(epoch + boost::posix_time::seconds(utc[i]),
+                                             tz_db.from_index(nodes[i].timezone()));
+      locals += (ldt.local_time() - epoch).total_seconds();
+    }
+    return locals;
+  });
+  double table_convert = bench::time_passes(iterations, table_local, [&]() {
+    int64_t locals = 0;
+    for (size_t i = 0; i < nodes.size(); ++i)
+      locals += tz_db.offsets_from_index(nodes[i].timezone()).to_local(utc[i]);
+    return locals;
+  });
+
+  if (looked_up != resolved || found != hashed || boost_local != table_local) {
+    std::cerr << "Lookups found different time zones" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << count << " nodes: region lookup " << lookup << " ms, from_index " << index
+            << " ms" << std::endl;
+  std::cout << names.size() << " regions: linear search " << linear << " ms, to_index "
+            << hash << " ms" << std::endl;
+  std::cout << count << " utc to local: local_date_time " << boost_convert
+            << " ms, utc offsets " << table_convert << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+#ifndef VALHALLA_BENCH_TIMING_H_
+#define VALHALLA_BENCH_TIMING_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace bench {
+
+// Times a number of passes, returns the average in ms. What the last pass
+// returns is kept in result so the work can't be optimized away, it is left
+// alone if there are no passes
+template <typename result_t, typename pass_t>
+double time_passes(const uint32_t iterations, result_t& result, const pass_t& pass) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint32_t i = 0; i < iterations; ++i)
+    result = pass();
+  auto end = std::chrono::high_resolution_clock::now();
+  return iterations == 0 ? 0.0 :
+    std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+}
+
+#endif  // VALHALLA_BENCH_TIMING_H_
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "baldr/graphtile.h"
+#include "timing.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// A tile made of just departures and schedules
+struct transit_tile : public GraphTile {
+  transit_tile(std::vector<TransitDeparture>& departures,
+               std::vector<TransitSchedule>& schedules) {
+    header_ = new GraphTileHeader();
+    header_->set_departurecount(departures.size());
+    header_->set_schedulecount(schedules.size());
+    departures_ = departures.data();
+    transit_schedules_ = schedules.data();
+    IndexDepartures();
+  }
+};
+
+}
+
+// Compares finding the valid departures of every line of a tile by looking
+// up and checking each departure's schedule against checking all the
+// schedules of the tile at once and filtering the departures by them.
+// usage: transit_schedules [lines] [iterations]
+int main(int argc, char** argv) {
+  uint32_t lines = argc > 1 ? std::atoi(argv[1]) : 2000;
+  uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+
+  // A tile holds at most 4096 unique schedules
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint64_t> days;
+  std::uniform_int_distribution<uint32_t> dows(1, kAllDaysOfWeek), end_days(0, kMaxEndDay);
+  std::vector<TransitSchedule> schedules;
+  for (uint32_t i = 0; i < 4000; ++i)
+    schedules.emplace_back(days(generator), dows(generator), end_days(generator));
+
+  // Lines with 10 to 100 departures over the day
+  std::uniform_int_distribution<uint32_t> counts(10, 100), times(0, 86399),
+      indices(0, schedules.size() - 1);
+  std::vector<TransitDeparture> departures;
+  for (uint32_t line = 0; line < lines; ++line) {
+    std::vector<uint32_t> departs(counts(generator));
+    for (auto& time : departs)
+      time = times(generator);
+    std::sort(departs.begin(), departs.end());
+    for (auto time : departs)
+      departures.emplace_back(line, departures.size(), 0, 0, 0, time, 60, indices(generator),
+                              true, true);
+  }
+  transit_tile tile(departures, schedules);
+
+  const uint32_t day = 20;
+  std::vector<const TransitDeparture*> found;
+  size_t one_by_one = 0, batched = 0;
+  double each = bench::time_passes(iterations, one_by_one, [&]() {
+    found.clear();
+    for (uint32_t line = 0; line < lines; ++line) {
+      for (const auto& dep : tile.GetDepartures(line)) {
+        if (tile.GetTransitSchedule(dep.schedule_index())->IsValid(day, kMonday, false))
+          found.push_back(&dep);
+      }
+    }
+    return found.size();
+  });
+  std::vector<uint8_t> valid;
+  double batch = bench::time_passes(iterations, batched, [&]() {
+    found.clear();
+    tile.GetValidSchedules(day, kMonday, false, valid);
+    for (uint32_t line = 0; line < lines; ++line)
+      GraphTile::FilterDepartures(tile.GetDepartures(line), valid, false, false, found);
+    return found.size();
+  });
+
+  if (one_by_one != batched) {
+    std::cerr << "Found different departures" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << departures.size() << " departures, " << schedules.size() << " schedules: "
+            << "IsValid each " << each << " ms, GetValidSchedules and FilterDepartures "
+            << batch << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,42 @@
+#!/bin/bash
+set -e
+
+# Turns boost's time zone csv into a C array of already parsed zones, so they
+# can be loaded without any text parsing. Offsets and times are in seconds,
+# rules are the nth (-1 for last) day of the week (0 is Sunday) of a month.
+# usage: zonespec_table.sh date_time/zonespec.csv > date_time_zonespec_table.h
+
+awk '
+function seconds(duration,    sign, parts) {
+  sign = 1
+  if (duration ~ /^-/) sign = -1
+  gsub(/^[-+]/, "", duration)
+  split(duration, parts, ":")
+  return sign * (parts[1] * 3600 + parts[2] * 60 + parts[3])
+}
+function rule(spec,    parts) {
+  if (spec == "") return "0, 0, 0"
+  split(spec, parts, ";")
+  return (parts[1] + 0) ", " (parts[2] + 0) ", " (parts[3] + 0)
+}
+BEGIN {
+  FS = "\",\""
+  print "// generated from " ARGV[1] " by scripts/zonespec_table.sh, do not edit"
+  print "const zonespec_t date_time_zonespec_table[] = {"
+}
+NR > 1 {
+  sub(/\r$/, "")
+  sub(/^"/, "")
+  sub(/"$/, "")
+  if (NF != 11) {
+    print "expected 11 fields on line " NR > "/dev/stderr"
+    exit 1
+  }
+  dst = $4 != ""
+  printf "  {\"%s\", \"%s\", \"%s\", \"%s\", \"%s\", %d, %d, %s, %d, %s, %d},\n", \
+    $1, $2, $3, $4, $5, seconds($6), dst ? seconds($7) : 0, \
+    dst ? rule($8) : rule(""), dst ? seconds($9) : 0, dst ? rule($10) : rule(""), dst ? seconds($11) : 0
+}
+END {
+  print "};"
+}' "$1"
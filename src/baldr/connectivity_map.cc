@@ -4,11 +4,19 @@
 #include "baldr/graphreader.h"
 
 #include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/constants.h>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <list>
+#include <memory>
 #include <iomanip>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <unordered_set>
 
 #include <valhalla/midgard/logging.h>
@@ -53,64 +61,67 @@ namespace {
      }
    */
 
-  json::MapPtr to_properties(uint64_t id, const std::string& color) {
-    return json::map({
-      {"fill", color},
-      {"stroke", std::string("white")},
-      {"stroke-width", static_cast<uint64_t>(1)},
-      {"fill-opacity", json::fp_t{0.8, 1}},
-      {"id", id},
-    });
+  void to_properties(uint64_t id, const std::string& color, json::StreamWriter& writer) {
+    writer.start_map();
+    writer("fill", color);
+    writer("stroke", "white");
+    writer("stroke-width", static_cast<uint64_t>(1));
+    writer("fill-opacity", json::fp_t{0.8, 1});
+    writer("id", id);
+    writer.end_map();
   }
 
   using ring_t = std::list<PointLL>;
   using polygon_t = std::list<ring_t>;
-  json::MapPtr to_geometry(const polygon_t& polygon) {
-    auto coords = json::array({});
+  void to_geometry(const polygon_t& polygon, json::StreamWriter& writer) {
+    writer.start_map();
+    writer("type", "Polygon");
+    writer.key("coordinates").start_array();
     bool outer = true;
     for(const auto& ring : polygon) {
-      auto ring_coords = json::array({});
-      for(const auto& coord : ring) {
-        if(outer)
-          ring_coords->emplace_back(json::array({json::fp_t{coord.first, 6}, json::fp_t{coord.second, 6}}));
-        else
-          ring_coords->emplace_front(json::array({json::fp_t{coord.first, 6}, json::fp_t{coord.second, 6}}));
-      }
-      coords->emplace_back(ring_coords);
+      auto write_coord = [&writer](const PointLL& coord) {
+        writer.start_array().value(json::fp_t{coord.first, 6}).value(json::fp_t{coord.second, 6}).end_array();
+      };
+      writer.start_array();
+      if(outer)
+        std::for_each(ring.cbegin(), ring.cend(), write_coord);
+      else
+        std::for_each(ring.crbegin(), ring.crend(), write_coord);
+      writer.end_array();
       outer = false;
     }
-    return json::map({
-      {"type", std::string("Polygon")},
-      {"coordinates", coords}
-    });
+    writer.end_array();
+    writer.end_map();
   }
 
-  json::MapPtr to_feature(const std::pair<size_t, polygon_t>& boundary, const std::string& color) {
-    return json::map({
-      {"type", std::string("Feature")},
-      {"geometry", to_geometry(boundary.second)},
-      {"properties", to_properties(boundary.first, color)}
-    });
+  void to_feature(const std::pair<size_t, polygon_t>& boundary, const std::string& color, json::StreamWriter& writer) {
+    writer.start_map();
+    writer("type", "Feature");
+    writer.key("geometry");
+    to_geometry(boundary.second, writer);
+    writer.key("properties");
+    to_properties(boundary.first, color, writer);
+    writer.end_map();
   }
 
   template <class T>
   std::string to_feature_collection(const std::unordered_map<size_t, polygon_t>& boundaries, const std::multimap<size_t, size_t, T>& arities) {
     std::default_random_engine generator;
     std::uniform_int_distribution<int> distribution(64,192);
-    auto features = json::array({});
+    json::StreamWriter writer;
+    writer.start_map();
+    writer("type", "FeatureCollection");
+    writer.key("features").start_array();
     for(const auto& arity : arities) {
       std::stringstream hex;
       hex << "#" << std::hex << distribution(generator);
       hex << std::hex << distribution(generator);
       hex << std::hex << distribution(generator);
-      features->emplace_back(to_feature(*boundaries.find(arity.second), hex.str()));
+      to_feature(*boundaries.find(arity.second), hex.str(), writer);
     }
-    std::stringstream ss;
-    ss << *json::map({
-      {"type", std::string("FeatureCollection")},
-      {"features", features}
-    });
-    return ss.str();
+    writer.end_array();
+    writer.end_map();
+    return writer.str();
   }
 
   polygon_t to_boundary(const std::pair<size_t, std::unordered_set<uint32_t> >& region, const Tiles<PointLL>& tiles) {
@@ -204,10 +215,239 @@ namespace {
     //give it back
     return polygon;
   }
+
+  constexpr uint64_t kNoTile = std::numeric_limits<uint64_t>::max();
+  constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+
+  //index of the first element of each tile, by level then tile id, given how many each tile has
+  template <class count_t>
+  std::vector<std::vector<uint64_t> > make_offsets(const std::vector<GraphId>& tiles, const count_t& count, uint64_t& total) {
+    std::vector<std::vector<uint64_t> > offsets;
+    total = 0;
+    for(const auto& tile : tiles) {
+      if(tile.level() >= offsets.size())
+        offsets.resize(tile.level() + 1);
+      auto& level = offsets[tile.level()];
+      if(tile.tileid() >= level.size())
+        level.resize(tile.tileid() + 1, kNoTile);
+      level[tile.tileid()] = total;
+      total += count(tile);
+    }
+    return offsets;
+  }
+
+  uint64_t get_offset(const std::vector<std::vector<uint64_t> >& offsets, const GraphId& id) {
+    if(id.level() >= offsets.size() || id.tileid() >= offsets[id.level()].size())
+      return kNoTile;
+    return offsets[id.level()][id.tileid()];
+  }
+
+  //the binary file the colors are cached in. the fingerprint of the tile set
+  //tells whether the file is still valid
+  constexpr char kColorFileMagic[4] = {'V', 'C', 'O', 'L'};
+  constexpr uint32_t kColorFileVersion = 1;
+  struct color_file_header_t {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t fingerprint;
+  };
+  struct color_file_entry_t {
+    uint32_t level;
+    uint32_t tileid;
+    uint32_t color;
+  };
+
+  //fnv-1a of the sorted tile ids, so it doesn't depend on the order they were found in
+  uint64_t fingerprint(const std::unordered_set<GraphId>& tile_set) {
+    std::vector<uint64_t> tiles(tile_set.cbegin(), tile_set.cend());
+    std::sort(tiles.begin(), tiles.end());
+    uint64_t hash = 14695981039346656037ull;
+    for(auto tile : tiles) {
+      for(int i = 0; i < 8; ++i) {
+        hash ^= (tile >> (i * 8)) & 0xff;
+        hash *= 1099511628211ull;
+      }
+    }
+    return hash;
+  }
+
+  //the loaded tiles by level then tile id
+  using tile_table_t = std::vector<std::vector<const GraphTile*> >;
+
+  tile_table_t make_tile_table(const std::vector<const GraphTile*>& tiles) {
+    tile_table_t table;
+    for(const auto* tile : tiles) {
+      auto id = tile->id();
+      if(id.level() >= table.size())
+        table.resize(id.level() + 1);
+      auto& level = table[id.level()];
+      if(id.tileid() >= level.size())
+        level.resize(id.tileid() + 1, nullptr);
+      level[id.tileid()] = tile;
+    }
+    return table;
+  }
+
+  const GraphTile* get_tile(const tile_table_t& table, const GraphId& id) {
+    if(id.level() >= table.size() || id.tileid() >= table[id.level()].size())
+      return nullptr;
+    return table[id.level()][id.tileid()];
+  }
+
+  //loads all the tiles, they must stay cached in the reader while they are used
+  std::vector<const GraphTile*> load_tiles(GraphReader& reader, const std::vector<GraphId>& ids) {
+    std::vector<const GraphTile*> tiles;
+    tiles.reserve(ids.size());
+    for(const auto& id : ids) {
+      const auto* tile = reader.GetGraphTile(id);
+      if(tile == nullptr)
+        throw std::runtime_error("Could not load tile " + std::to_string(id.tileid()) +
+                                 " on level " + std::to_string(id.level()));
+      tiles.push_back(tile);
+    }
+    return tiles;
+  }
+
+  //transitions between levels carry no access so are open to every mode
+  bool traversable(const DirectedEdge* edge, uint32_t access) {
+    return !edge->is_shortcut() && (edge->trans_up() || edge->trans_down() || (edge->forwardaccess() & access));
+  }
 }
 
 namespace valhalla {
   namespace baldr {
+    constexpr uint32_t component_map_t::kNoComponent;
+
+    component_map_t::component_map_t(GraphReader& reader, const std::vector<GraphId>& tiles, uint32_t access)
+      :component_map_t(load_tiles(reader, tiles), access) {
+    }
+
+    component_map_t::component_map_t(const std::vector<const GraphTile*>& tiles, uint32_t access)
+      :count(0), access_mask(access) {
+      //number the nodes and edges of all the tiles
+      auto table = make_tile_table(tiles);
+      uint64_t node_count, edge_count;
+      std::vector<GraphId> ids;
+      for(const auto* tile : tiles)
+        ids.push_back(tile->id());
+      auto node_offsets = make_offsets(ids, [&table](const GraphId& id) {
+        return get_tile(table, id)->header()->nodecount(); }, node_count);
+      edge_offsets = make_offsets(ids, [&table](const GraphId& id) {
+        return get_tile(table, id)->header()->directededgecount(); }, edge_count);
+      if(node_count >= kUnvisited)
+        throw std::runtime_error("Too many nodes to find components");
+
+      //tarjan's algorithm without recursion, a node is on the stack if it has
+      //been visited but has no component yet
+      std::vector<uint32_t> index(node_count, kUnvisited), lowlink(node_count), node_components(node_count, kNoComponent);
+      std::vector<uint32_t> stack;
+      struct frame_t {
+        uint32_t node;
+        const GraphTile* tile;
+        DirectedEdgeRange::const_iterator next_edge, end_edge;
+      };
+      std::vector<frame_t> frames;
+      uint32_t visited = 0;
+      auto visit = [&](const GraphId& node_id, uint32_t node, const GraphTile* tile) {
+        index[node] = lowlink[node] = visited++;
+        stack.push_back(node);
+        const auto edges = tile->edges(node_id);
+        frames.push_back({node, tile, edges.begin(), edges.end()});
+      };
+
+      for(const auto* start_tile : tiles) {
+        const auto tile_id = start_tile->id();
+        const auto start_offset = get_offset(node_offsets, tile_id);
+        for(uint32_t i = 0; i < start_tile->header()->nodecount(); ++i) {
+          if(index[start_offset + i] != kUnvisited)
+            continue;
+          visit(GraphId(tile_id.tileid(), tile_id.level(), i), start_offset + i, start_tile);
+          while(!frames.empty()) {
+            auto& frame = frames.back();
+            //follow the next edge
+            if(frame.next_edge != frame.end_edge) {
+              const auto* edge = (*frame.next_edge++).second;
+              auto end_offset = get_offset(node_offsets, edge->endnode());
+              if(!traversable(edge, access) || end_offset == kNoTile)
+                continue;
+              uint32_t end = end_offset + edge->endnode().id();
+              if(index[end] == kUnvisited) {
+                const auto* end_tile = edge->endnode().Tile_Base() == frame.tile->id() ?
+                  frame.tile : get_tile(table, edge->endnode());
+                visit(edge->endnode(), end, end_tile);
+              }
+              else if(node_components[end] == kNoComponent)
+                lowlink[frame.node] = std::min(lowlink[frame.node], index[end]);
+              continue;
+            }
+            //all edges followed, the node is the root of a component if it can't reach an earlier one
+            uint32_t node = frame.node;
+            frames.pop_back();
+            if(lowlink[node] == index[node]) {
+              uint32_t member;
+              do {
+                member = stack.back();
+                stack.pop_back();
+                node_components[member] = count;
+              } while(member != node);
+              ++count;
+            }
+            if(!frames.empty())
+              lowlink[frames.back().node] = std::min(lowlink[frames.back().node], lowlink[node]);
+          }
+        }
+      }
+
+      //an edge is within a component if both of its nodes are
+      edge_components.resize(edge_count, kNoComponent);
+      for(const auto* tile : tiles) {
+        auto node_offset = get_offset(node_offsets, tile->id());
+        auto edge_offset = get_offset(edge_offsets, tile->id());
+        for(uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+          auto component = node_components[node_offset + i];
+          for(const auto& edge : tile->edges(static_cast<size_t>(i))) {
+            auto end_offset = get_offset(node_offsets, edge.second->endnode());
+            if(traversable(edge.second, access) && end_offset != kNoTile &&
+               node_components[end_offset + edge.second->endnode().id()] == component)
+              edge_components[edge_offset + edge.first.id()] = component;
+          }
+        }
+      }
+    }
+
+    uint32_t component_map_t::get_component(const GraphId& edge) const {
+      auto offset = get_offset(edge_offsets, edge);
+      if(offset == kNoTile || offset + edge.id() >= edge_components.size())
+        return kNoComponent;
+      return edge_components[offset + edge.id()];
+    }
+
+    bool component_map_t::mutually_reachable(const baldr::PathLocation& a, const baldr::PathLocation& b) const {
+      //a route there and back is a cycle through both edges, so they are in the same component.
+      //sharing an edge isn't enough, a one way edge without a component can only be followed
+      //one way. an edge open both ways always has a component, which covers locations on
+      //opposite directions of it
+      for(const auto& edge_a : a.edges) {
+        auto component = get_component(edge_a.id);
+        if(component == kNoComponent)
+          continue;
+        for(const auto& edge_b : b.edges) {
+          if(component == get_component(edge_b.id))
+            return true;
+        }
+      }
+      return false;
+    }
+
+    size_t component_map_t::component_count() const {
+      return count;
+    }
+
+    uint32_t component_map_t::access() const {
+      return access_mask;
+    }
+
     connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt)
       :tile_hierarchy(pt.get<std::string>("tile_dir")) {
       // See what kind of tiles we are dealing with here by getting a graphreader
@@ -215,6 +455,12 @@ namespace valhalla {
       auto tiles = reader.GetTileSet();
       transit_level = tile_hierarchy.levels().rbegin()->second.level + 1;
 
+      // Reuse the colors from the last time if the tiles haven't changed
+      auto cache = pt.get<std::string>("connectivity_cache", "");
+      auto tiles_fingerprint = fingerprint(tiles);
+      if(!cache.empty() && read_colors(cache, tiles_fingerprint))
+        return;
+
       // Populate a map for each level of the tiles that exist
       for(const auto& t : tiles) {
         auto& level_colors = colors.insert({t.level(), std::unordered_map<uint32_t, size_t>{}}).first->second;
@@ -229,6 +475,97 @@ namespace valhalla {
         else
           tile_hierarchy.levels().find(color.first)->second.tiles.ColorMap(color.second);
       }
+
+      if(!cache.empty())
+        write_colors(cache, tiles_fingerprint);
+    }
+
+    bool connectivity_map_t::read_colors(const std::string& file, uint64_t fingerprint) {
+      std::ifstream in(file, std::ios::binary);
+      if(!in)
+        return false;
+      color_file_header_t header;
+      if(!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+         std::memcmp(header.magic, kColorFileMagic, sizeof(header.magic)) != 0 ||
+         header.version != kColorFileVersion || header.fingerprint != fingerprint) {
+        LOG_INFO("Connectivity cache " + file + " is stale, recomputing");
+        return false;
+      }
+      std::vector<color_file_entry_t> entries(header.count);
+      if(!in.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(color_file_entry_t))) {
+        LOG_WARN("Connectivity cache " + file + " is truncated, recomputing");
+        return false;
+      }
+      for(const auto& entry : entries)
+        colors[entry.level][entry.tileid] = entry.color;
+      return true;
+    }
+
+    void connectivity_map_t::write_colors(const std::string& file, uint64_t fingerprint) const {
+      // Sorted so the same tiles always give the same file
+      std::vector<color_file_entry_t> entries;
+      for(const auto& level : colors)
+        for(const auto& color : level.second)
+          entries.push_back({level.first, color.first, static_cast<uint32_t>(color.second)});
+      std::sort(entries.begin(), entries.end(), [](const color_file_entry_t& a, const color_file_entry_t& b) {
+        return a.level < b.level || (a.level == b.level && a.tileid < b.tileid);
+      });
+      color_file_header_t header;
+      std::memcpy(header.magic, kColorFileMagic, sizeof(header.magic));
+      header.version = kColorFileVersion;
+      header.count = entries.size();
+      header.fingerprint = fingerprint;
+
+      // Write to the side and move it into place so readers never see half a file
+      auto temp = file + ".tmp";
+      {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(color_file_entry_t));
+        if(!out) {
+          LOG_WARN("Could not write connectivity cache " + file);
+          return;
+        }
+      }
+      boost::system::error_code ec;
+      boost::filesystem::rename(temp, file, ec);
+      if(ec)
+        LOG_WARN("Could not write connectivity cache " + file + ": " + ec.message());
+    }
+
+    connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt, const std::vector<uint32_t>& access_modes)
+      :connectivity_map_t(pt) {
+      //sorted so that components are numbered the same every time
+      GraphReader reader(pt);
+      auto tile_set = reader.GetTileSet();
+      std::vector<GraphId> tiles(tile_set.cbegin(), tile_set.cend());
+      std::sort(tiles.begin(), tiles.end());
+
+      //the tiles are loaded once, each mode gets its own thread which only
+      //reads them as readers aren't thread safe
+      auto loaded = load_tiles(reader, tiles);
+      std::vector<std::unique_ptr<component_map_t> > results(access_modes.size());
+      std::vector<std::exception_ptr> errors(access_modes.size());
+      std::vector<std::thread> threads;
+      for(size_t i = 0; i < access_modes.size(); ++i) {
+        threads.emplace_back([&, i]() {
+          try {
+            results[i].reset(new component_map_t(loaded, access_modes[i]));
+          }
+          catch(...) {
+            errors[i] = std::current_exception();
+          }
+        });
+      }
+      for(auto& thread : threads)
+        thread.join();
+      for(size_t i = 0; i < access_modes.size(); ++i) {
+        if(errors[i])
+          std::rethrow_exception(errors[i]);
+        LOG_INFO("Found " + std::to_string(results[i]->component_count()) +
+                 " components for access " + std::to_string(access_modes[i]));
+        components.emplace(access_modes[i], std::move(*results[i]));
+      }
     }
 
     size_t connectivity_map_t::get_color(const GraphId& id) const {
@@ -248,22 +585,69 @@ namespace valhalla {
       auto level = colors.find(hierarchy_level);
       if(level == colors.cend())
         return result;
-      const auto& tiles = tile_hierarchy.levels().find(hierarchy_level)->second.tiles;
-      for(const auto& edge : location.edges) {
-        //TODO: generate more ids by intersecting this circle with the tiles object
-        //take the edge.projected and subtract radius in the x and y dimensions
-        //convert that into a tileid and get its col,row tile coords that will start the for loop
-        //add radius in the x and y to edge.projected to get the ending tile col,row for the for loop
-        //then while iterating create a tile for each tile col,row pair, get its aabb2 and call
-        //aabb2::intersects(edge.projected, radius), if it returns true, get the color as below
-        auto id = tiles.TileId(edge.projected);
+      // Transit level uses local hierarchy tiles
+      const auto& tiles = hierarchy_level == transit_level ? tile_hierarchy.levels().rbegin()->second.tiles :
+        tile_hierarchy.levels().find(hierarchy_level)->second.tiles;
+      auto add_color = [&result, &level](int32_t id) {
         auto color = level->second.find(id);
         if(color != level->second.cend())
           result.emplace(color->second);
+      };
+      for(const auto& edge : location.edges) {
+        auto id = tiles.TileId(edge.projected);
+        if(radius <= 0.f || id < 0) {
+          add_color(id);
+          continue;
+        }
+
+        // The rows and columns of the box around the circle, all columns near the poles
+        const auto& center = edge.projected;
+        float lat_radius = radius / kMetersPerDegreeLat;
+        float cos_lat = std::cos((std::fabs(center.lat()) + lat_radius) * kRadPerDeg);
+        auto rc = tiles.GetRowColumn(id);
+        int32_t row_radius = static_cast<int32_t>(std::ceil(lat_radius / tiles.TileSize()));
+        int32_t col_radius = cos_lat > 0.f ? static_cast<int32_t>(std::ceil(lat_radius / cos_lat / tiles.TileSize())) : tiles.ncolumns();
+        int32_t min_row = std::max(0, rc.first - row_radius), max_row = std::min(tiles.nrows() - 1, rc.first + row_radius);
+        int32_t min_col = std::max(0, rc.second - col_radius), max_col = std::min(tiles.ncolumns() - 1, rc.second + col_radius);
+
+        // Add the colors of the tiles whose closest point is within the radius
+        for(int32_t row = min_row; row <= max_row; ++row) {
+          for(int32_t col = min_col; col <= max_col; ++col) {
+            auto tile = tiles.TileId(col, row);
+            auto box = tiles.TileBounds(tile);
+            PointLL closest(std::min(std::max(center.lng(), box.minx()), box.maxx()),
+                            std::min(std::max(center.lat(), box.miny()), box.maxy()));
+            if(center.Distance(closest) <= radius)
+              add_color(tile);
+          }
+        }
       }
       return result;
     }
 
+    uint32_t connectivity_map_t::get_component(const GraphId& edge, uint32_t access) const {
+      auto mode = components.find(access);
+      if(mode == components.cend())
+        return component_map_t::kNoComponent;
+      return mode->second.get_component(edge);
+    }
+
+    bool connectivity_map_t::mutually_reachable(const baldr::PathLocation& a, const baldr::PathLocation& b, uint32_t access) const {
+      auto mode = components.find(access);
+      if(mode != components.cend())
+        return mode->second.mutually_reachable(a, b);
+
+      //without components the best we can do is the tile colors
+      for(const auto& edge_a : a.edges) {
+        auto color = get_color(edge_a.id);
+        for(const auto& edge_b : b.edges) {
+          if(color == get_color(edge_b.id))
+            return true;
+        }
+      }
+      return false;
+    }
+
     std::string connectivity_map_t::to_geojson(const uint32_t hierarchy_level) const {
       //bail if we dont have the level
       auto bbox = tile_hierarchy.levels().find(
@@ -1,7 +1,7 @@
 #include <iostream>
 #include <sstream>
-#include <bitset>
 #include <fstream>
+#include <limits>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/range/algorithm/remove_if.hpp>
@@ -12,13 +12,135 @@
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
 
-#include "date_time_zonespec.h"
+namespace {
+
+//a zone from date_time/zonespec.csv, already parsed
+struct zonespec_t {
+  const char* region;
+  const char* std_abbr;
+  const char* std_name;
+  const char* dst_abbr;
+  const char* dst_name;
+  int32_t utc_offset;
+  int32_t dst_offset;
+  int8_t start_nth;
+  int8_t start_day;
+  int8_t start_month;
+  int32_t start_time;
+  int8_t end_nth;
+  int8_t end_day;
+  int8_t end_month;
+  int32_t end_time;
+};
+
+#include "date_time_zonespec_table.h"
+
+}
 
 using namespace valhalla::baldr;
 
 namespace {
 
 const boost::gregorian::date pivot_date_ = boost::gregorian::from_undelimited_string(kPivotDate);
+const boost::posix_time::ptime epoch_(boost::gregorian::date(1970, 1, 1));
+
+int64_t to_seconds(const boost::posix_time::ptime& time) {
+  return (time - epoch_).total_seconds();
+}
+
+//parse exactly count digits
+bool parse_digits(const char*& c, const char* end, const size_t count, int32_t& value) {
+  if (static_cast<size_t>(end - c) < count)
+    return false;
+  value = 0;
+  for (const char* last = c + count; c < last; ++c) {
+    if (*c < '0' || *c > '9')
+      return false;
+    value = value * 10 + (*c - '0');
+  }
+  return true;
+}
+
+//parse HH:MM or HH:MM:SS, hours can be up to 4 digits
+bool parse_time(const char* c, const char* end, DateTime::date_time_fields_t& fields) {
+  const char* start = c;
+  for (fields.hour = 0; c < end && c - start < 4 && *c >= '0' && *c <= '9'; ++c)
+    fields.hour = fields.hour * 10 + (*c - '0');
+  if (c == start || c == end || *c++ != ':' ||
+      !parse_digits(c, end, 2, fields.minute))
+    return false;
+  if (c != end && (*c++ != ':' || !parse_digits(c, end, 2, fields.second)))
+    return false;
+  fields.has_time = c == end;
+  return fields.has_time;
+}
+
+//a day inside the years the offset tables cover, so local times fit too
+const int64_t min_offset_seconds_ = to_seconds(boost::posix_time::ptime(
+  boost::gregorian::date(DateTime::kMinOffsetYear, 1, 2)));
+const int64_t max_offset_seconds_ = to_seconds(boost::posix_time::ptime(
+  boost::gregorian::date(DateTime::kMaxOffsetYear, 12, 31)));
+
+DateTime::tz_offsets_t make_offsets(const boost::local_time::time_zone_ptr& time_zone) {
+  DateTime::tz_offsets_t table;
+  const auto min = std::numeric_limits<int64_t>::min();
+  int32_t standard = time_zone ? time_zone->base_utc_offset().total_seconds() : 0;
+  if(!time_zone || !time_zone->has_dst()) {
+    table.entries.push_back({min, min, standard, false});
+    return table;
+  }
+
+  //dst starts in standard local time and ends in daylight local time. like
+  //get_ldt, local times skipped or repeated by a change are standard time
+  int32_t daylight = standard + time_zone->dst_offset().total_seconds();
+  std::vector<DateTime::tz_offsets_t::entry_t> changes;
+  for(int year = DateTime::kMinOffsetYear; year <= DateTime::kMaxOffsetYear; ++year) {
+    int64_t start = to_seconds(time_zone->dst_local_start_time(year)) - standard;
+    changes.push_back({start, start + daylight, daylight, true});
+    //boost decides dst by the day the time falls on, so when dst ends just
+    //after midnight it lasts until that midnight
+    auto end_time = time_zone->dst_local_end_time(year);
+    int64_t end = to_seconds(end_time) - daylight;
+    int64_t midnight = to_seconds(boost::posix_time::ptime(end_time.date()));
+    changes.push_back({std::max(end, midnight - standard), std::max(end + standard, midnight), standard, false});
+  }
+  std::sort(changes.begin(), changes.end(),
+    [](const DateTime::tz_offsets_t::entry_t& a, const DateTime::tz_offsets_t::entry_t& b) {
+      return a.utc < b.utc;
+    });
+
+  //before the first change it is whatever that change isnt
+  bool dst = !changes.front().dst;
+  table.entries.push_back({min, min, dst ? daylight : standard, dst});
+  for(const auto& change : changes) {
+    if(change.dst != table.entries.back().dst)
+      table.entries.push_back(change);
+  }
+  return table;
+}
+
+//a utc time as seen in a time zone
+struct zoned_time_t {
+  boost::posix_time::ptime local;
+  bool dst;
+  boost::posix_time::time_duration offset;
+};
+
+//the offset tables give the local time when they cover it, otherwise boost works it out
+zoned_time_t to_zoned_time(const int64_t utc, const boost::local_time::time_zone_ptr& time_zone) {
+  const auto& tz_db = DateTime::get_tz_db();
+  size_t index = tz_db.zone_index(time_zone);
+  if (index && DateTime::tz_offsets_t::covers(utc)) {
+    const auto& entry = tz_db.offsets_from_index(index).at_utc(utc);
+    return {epoch_ + boost::posix_time::seconds(utc + entry.offset), entry.dst,
+            boost::posix_time::seconds(entry.offset)};
+  }
+  boost::local_time::local_date_time date_time(epoch_ + boost::posix_time::seconds(utc), time_zone);
+  auto offset = time_zone->base_utc_offset();
+  if (date_time.is_dst())
+    offset = time_zone->dst_offset() + offset;
+  return {date_time.local_time(), date_time.is_dst(), offset};
+}
 
 }
 
@@ -27,25 +149,71 @@ namespace baldr {
 namespace DateTime {
 
 tz_db_t::tz_db_t() {
-  //load up the tz data
-  std::string tz_data(date_time_zonespec_csv, date_time_zonespec_csv + date_time_zonespec_csv_len);
-  std::stringstream ss(tz_data);
-  load_from_stream(ss);
+  //load up the tz data, the same as load_from_stream would from the csv
+  using rule_t = boost::local_time::nth_kday_dst_rule;
+  auto week = [](int nth) {
+    return nth >= 1 && nth <= 4 ? static_cast<rule_t::start_rule::week_num>(nth) : rule_t::start_rule::fifth;
+  };
+  for(const auto& spec : date_time_zonespec_table) {
+    boost::local_time::time_zone_names names(spec.std_name, spec.std_abbr, spec.dst_name, spec.dst_abbr);
+    boost::local_time::dst_adjustment_offsets adjust(boost::posix_time::seconds(0),
+      boost::posix_time::seconds(0), boost::posix_time::seconds(0));
+    boost::shared_ptr<boost::local_time::dst_calc_rule> rules;
+    if(spec.dst_abbr[0] != '\0') {
+      adjust = boost::local_time::dst_adjustment_offsets(boost::posix_time::seconds(spec.dst_offset),
+        boost::posix_time::seconds(spec.start_time), boost::posix_time::seconds(spec.end_time));
+      rules.reset(new rule_t(rule_t::start_rule(week(spec.start_nth), spec.start_day, spec.start_month),
+        rule_t::end_rule(week(spec.end_nth), spec.end_day, spec.end_month)));
+    }
+    add_record(spec.region, boost::shared_ptr<time_zone_base_type>(
+      new boost::local_time::custom_time_zone(names, boost::posix_time::seconds(spec.utc_offset), adjust, rules)));
+  }
   //unfortunately boosts object has its map marked as private... so we have to keep our own
   regions = region_list();
+  //resolve every zone up front, index 0 means no time zone
+  zones.reserve(regions.size() + 1);
+  zones.emplace_back();
+  for(const auto& region : regions) {
+    region_indices.emplace(region, zones.size());
+    zone_indices.emplace(time_zone_from_region(region).get(), zones.size());
+    zones.emplace_back(time_zone_from_region(region));
+  }
+  //most programs only ever need the offsets of a few zones
+  offsets.resize(zones.size());
+  offsets_built = std::vector<std::once_flag>(zones.size());
 }
 
 size_t tz_db_t::to_index(const std::string& region) const {
-  auto it = std::find(regions.cbegin(), regions.cend(), region);
-  if(it == regions.cend())
+  auto it = region_indices.find(region);
+  if(it == region_indices.cend())
+    return 0;
+  return it->second;
+}
+
+const boost::shared_ptr<boost::local_time::tz_database::time_zone_base_type>& tz_db_t::from_index(size_t index) const {
+  if(index >= zones.size())
+    return zones.front();
+  return zones[index];
+}
+
+size_t tz_db_t::zone_index(const boost::shared_ptr<time_zone_base_type>& time_zone) const {
+  auto it = zone_indices.find(time_zone.get());
+  if(it == zone_indices.cend())
     return 0;
-  return (it - regions.cbegin()) + 1;
+  return it->second;
+}
+
+const tz_offsets_t& tz_db_t::offsets_from_index(size_t index) const {
+  if(index >= offsets.size())
+    index = 0;
+  std::call_once(offsets_built[index], [this, index]() {
+    offsets[index] = make_offsets(zones[index]);
+  });
+  return offsets[index];
 }
 
-boost::shared_ptr<boost::local_time::tz_database::time_zone_base_type> tz_db_t::from_index(size_t index) const {
-  if(index < 1 || index > regions.size())
-    return {};
-  return time_zone_from_region(regions[index - 1]);
+bool tz_offsets_t::covers(int64_t seconds) {
+  return min_offset_seconds_ <= seconds && seconds <= max_offset_seconds_;
 }
 
 const tz_db_t& get_tz_db() {
@@ -65,8 +233,44 @@ std::string get_testing_date_time() {
   return to_iso_extended_string(d) + "T08:00";
 }
 
+bool parse_date_time(const std::string& date_time, date_time_fields_t& fields) {
+  fields = date_time_fields_t{};
+  const char* c = date_time.data();
+  const char* end = c + date_time.size();
+
+  //just a time, the hours come before a colon
+  const char* colon = c;
+  while (colon < end && *colon >= '0' && *colon <= '9')
+    ++colon;
+  if (colon < end && *colon == ':')
+    return parse_time(c, end, fields);
+
+  //YYYYMMDD or YYYY-MM-DD
+  if (!parse_digits(c, end, 4, fields.year))
+    return false;
+  bool dashes = c < end && *c == '-';
+  c += dashes;
+  if (!parse_digits(c, end, 2, fields.month))
+    return false;
+  if (dashes && (c == end || *c++ != '-'))
+    return false;
+  if (!parse_digits(c, end, 2, fields.day))
+    return false;
+  fields.has_date = true;
+  if (c == end)
+    return true;
+
+  //and maybe THH:MM
+  return *c++ == 'T' && parse_time(c, end, fields);
+}
+
 //get a formatted date.
 boost::gregorian::date get_formatted_date(const std::string& date) {
+  date_time_fields_t fields;
+  if (parse_date_time(date, fields) && fields.has_date)
+    return boost::gregorian::date(fields.year, fields.month, fields.day);
+
+  //the leftovers boost might still make sense of
   boost::gregorian::date d;
   if (date.find("T") != std::string::npos) {
     std::string dt = date;
@@ -117,69 +321,55 @@ boost::local_time::local_date_time get_ldt(const boost::gregorian::date& date,
 //set the bits based on the dow.
 uint64_t get_service_days(boost::gregorian::date& start_date, boost::gregorian::date& end_date,
                           const uint32_t tile_date, const uint32_t dow_mask) {
-
   boost::gregorian::date tile_header_date = pivot_date_ + boost::gregorian::days(tile_date);
-
-  // if our start date is more than 60 days out, reject.
-  if (start_date > (tile_header_date + boost::gregorian::days(59)))
-    return 0;
-
-  if (start_date <= tile_header_date && tile_header_date <= end_date)
+  service_range_t service{static_cast<int32_t>((start_date - pivot_date_).days()),
+                          static_cast<int32_t>((end_date - pivot_date_).days()), dow_mask};
+  uint64_t days = get_service_days(service, tile_date);
+
+  //callers get the dates cut to the 60 days, as long as the service is in them
+  if (service.start_date > static_cast<int32_t>(tile_date) + 59 ||
+      service.end_date < static_cast<int32_t>(tile_date))
+    return days;
+  if (start_date <= tile_header_date)
     start_date = tile_header_date;
-  else if (tile_header_date > end_date) //reject.
-    return 0;
-
-  // only support 60 days out.  (59 days and include the end_date = 60)
   boost::gregorian::date enddate = tile_header_date + boost::gregorian::days(59);
-
   if (enddate <= end_date)
     end_date = enddate;
+  return days;
+}
 
-  uint32_t days = 0;
-  boost::gregorian::day_iterator itr(tile_header_date + boost::gregorian::days(days));
-
-  uint32_t x = days;
-  uint64_t bit_set = 0;
-
-  //TODO: we dont have to loop over all days, we could take the week mask, shift it by the start date
-  //then use that weekly mask and shift it how ever many times a week fits into the 60 day interval
-  //loop over all the days
-  while (itr <= end_date) {
-
-    //figure out what day of the week we are at
-    uint8_t dow;
-    switch ((*itr).day_of_week().as_enum()) {
-      case boost::date_time::Sunday:
-        dow = kSunday;
-        break;
-      case boost::date_time::Monday:
-        dow = kMonday;
-        break;
-      case boost::date_time::Tuesday:
-        dow = kTuesday;
-        break;
-      case boost::date_time::Wednesday:
-        dow = kWednesday;
-        break;
-      case boost::date_time::Thursday:
-        dow = kThursday;
-        break;
-      case boost::date_time::Friday:
-        dow = kFriday;
-        break;
-      case boost::date_time::Saturday:
-        dow = kSaturday;
-        break;
-    }
+//Get the days that this transit service is running in 60 days or less, bit 0 being the tile date
+uint64_t get_service_days(const service_range_t& service, const uint32_t tile_date) {
+  //only support 60 days out. (59 days and include the end_date = 60)
+  int32_t first = std::max(service.start_date, static_cast<int32_t>(tile_date));
+  int32_t last = std::min(service.end_date, static_cast<int32_t>(tile_date) + 59);
+  if (first > last)
+    return 0;
 
-    //were we supposed to be on for this day
-    if ((dow_mask & dow) && (itr >= start_date))
-      bit_set |= static_cast<uint64_t>(1) << x;
+  //rotate the week so its first day is the tile date's day
+  uint32_t dow = day_of_week(tile_date);
+  uint64_t week = service.dow_mask & 0x7f;
+  week = ((week >> dow) | (week << (7 - dow))) & 0x7f;
 
-    ++itr;
-    ++x;
-  }
-  return bit_set;
+  //repeat it every 7 bits and keep the days in range
+  uint64_t days = week * 0x8102040810204081ULL;
+  days &= ~uint64_t(0) >> (63 - (last - tile_date));
+  days &= ~uint64_t(0) << (first - tile_date);
+  return days;
+}
+
+void get_service_days(const std::vector<service_range_t>& services, const uint32_t tile_date,
+                      std::vector<uint64_t>& days) {
+  days.resize(services.size());
+  for(size_t i = 0; i < services.size(); ++i)
+    days[i] = get_service_days(services[i], tile_date);
+}
+
+//Get the day of the week of a day since pivot, 0 is Sunday
+uint32_t day_of_week(const int32_t date) {
+  //the pivot date, January 1, 2014, was a Wednesday
+  int32_t dow = (date + 3) % 7;
+  return dow < 0 ? dow + 7 : dow;
 }
 
 //add a service day to the days if it is in range.
@@ -214,17 +404,9 @@ uint64_t remove_service_day(const uint64_t& days, const boost::gregorian::date&
 
 // check if service is available for a date.
 bool is_service_available(const uint64_t days, const uint32_t start_date, const uint32_t date, const uint32_t end_date) {
-
-  if (start_date <= date && date <= end_date) {
-    boost::gregorian::date start = pivot_date_ + boost::gregorian::days(start_date);
-    boost::gregorian::date d = pivot_date_ + boost::gregorian::days(date);
-
-    std::bitset<64> bit_set(days);
-    boost::gregorian::date_period range(start, d);
-    uint32_t length = range.length().days();
-    return bit_set.test(length);
-  }
-  return false;
+  //bit 0 is the start date, there are only 64 of them
+  uint32_t day = date - start_date;
+  return start_date <= date && date <= end_date && day < 64 && ((days >> day) & 1);
 }
 
 //Get the number of days that have elapsed from the pivot date for the inputed date.
@@ -340,14 +522,8 @@ uint64_t seconds_since_epoch(const boost::local_time::time_zone_ptr& time_zone)
       return 0;
 
     try {
-      boost::posix_time::ptime pt = boost::posix_time::second_clock::universal_time();
-      boost::local_time::local_date_time local_date_time(pt,time_zone);
-
-      boost::posix_time::ptime const time_epoch(boost::gregorian::date(1970, 1, 1));
-      boost::posix_time::time_duration diff = local_date_time.utc_time() - time_epoch;
-
-      return diff.total_seconds();
-
+      //the time zone makes no difference to the utc time
+      return to_seconds(boost::posix_time::second_clock::universal_time());
     } catch (std::exception& e){}
     return 0;
 }
@@ -385,6 +561,13 @@ uint64_t seconds_since_epoch(const std::string& date_time,
 
     }
 
+    //a binary search in the utc offsets if we have them
+    const auto& tz_db = get_tz_db();
+    int64_t local = to_seconds(boost::posix_time::ptime(date, td));
+    size_t index = tz_db.zone_index(time_zone);
+    if (index && tz_offsets_t::covers(local))
+      return tz_db.offsets_from_index(index).to_utc(local);
+
     boost::local_time::local_date_time in_local_time = get_ldt(date,td,time_zone);
 
     boost::local_time::time_zone_ptr tz_utc(new boost::local_time::posix_time_zone("UTC"));
@@ -412,38 +595,37 @@ void seconds_to_date(const bool is_depart_at,
     return;
 
   try {
-    std::string tz_string;
-    boost::posix_time::ptime const time_epoch(boost::gregorian::date(1970, 1, 1));
-    boost::posix_time::ptime origin_pt = time_epoch + boost::posix_time::seconds(origin_seconds);
-    boost::local_time::local_date_time origin_date_time(origin_pt,origin_tz);
+    int64_t origin_utc = origin_seconds;
+    int64_t dest_utc = dest_seconds;
+    auto origin = to_zoned_time(origin_utc, origin_tz);
+    auto dest = to_zoned_time(dest_utc, dest_tz);
 
-    boost::posix_time::ptime dest_pt = time_epoch + boost::posix_time::seconds(dest_seconds);
-    boost::local_time::local_date_time dest_date_time(dest_pt,dest_tz);
+    boost::gregorian::date o_date = origin.local.date();
+    boost::gregorian::date d_date = dest.local.date();
 
-    boost::gregorian::date o_date = origin_date_time.local_time().date();
-    boost::gregorian::date d_date = dest_date_time.local_time().date();
-
-    if (is_depart_at && dest_date_time.is_dst()) {
+    if (is_depart_at && dest.dst) {
       boost::gregorian::date dst_date = dest_tz->dst_local_end_time(d_date.year()).date();
       bool in_range = (o_date <= dst_date && dst_date <= d_date);
 
       if (in_range) { // in range meaning via the dates.
         if (o_date == dst_date) {
           // must start before dst end time - the offset otherwise the time is ambiguous
-          in_range = origin_date_time.local_time().time_of_day() <
+          in_range = origin.local.time_of_day() <
               (dest_tz->dst_local_end_time(d_date.year()).time_of_day() - dest_tz->dst_offset());
 
           if (in_range) {
             // starts and ends on the same day.
             if (o_date == d_date)
-              in_range = dest_tz->dst_local_end_time(d_date.year()).time_of_day() <= dest_date_time.local_time().time_of_day();
+              in_range = dest_tz->dst_local_end_time(d_date.year()).time_of_day() <= dest.local.time_of_day();
           }
         }
         else if (dst_date == d_date)
-          in_range = dest_tz->dst_local_end_time(d_date.year()).time_of_day() <= dest_date_time.local_time().time_of_day();
+          in_range = dest_tz->dst_local_end_time(d_date.year()).time_of_day() <= dest.local.time_of_day();
+      }
+      if (in_range) {
+        dest_utc -= dest_tz->dst_offset().total_seconds();
+        dest = to_zoned_time(dest_utc, dest_tz);
       }
-      if (in_range)
-        dest_date_time -= dest_tz->dst_offset();
     }
 
     if (!is_depart_at) {
@@ -453,26 +635,27 @@ void seconds_to_date(const bool is_depart_at,
       if (in_range) { // in range meaning via the dates.
         if (o_date == dst_date) {
           // must start before dst end time
-          in_range = origin_date_time.local_time().time_of_day() <=
+          in_range = origin.local.time_of_day() <=
               (origin_tz->dst_local_end_time(o_date.year()).time_of_day());
 
           if (in_range) {
             // starts and ends on the same day.
             if (o_date == d_date)
-              in_range = origin_tz->dst_local_end_time(o_date.year()).time_of_day() > dest_date_time.local_time().time_of_day();
+              in_range = origin_tz->dst_local_end_time(o_date.year()).time_of_day() > dest.local.time_of_day();
           }
         } else if (dst_date == d_date)
-          in_range = origin_tz->dst_local_end_time(o_date.year()).time_of_day() > dest_date_time.local_time().time_of_day();
+          in_range = origin_tz->dst_local_end_time(o_date.year()).time_of_day() > dest.local.time_of_day();
       }
 
-      if (in_range)
-        origin_date_time -= origin_tz->dst_offset();
+      if (in_range) {
+        origin_utc -= origin_tz->dst_offset().total_seconds();
+        origin = to_zoned_time(origin_utc, origin_tz);
+      }
     }
 
-    origin_pt = origin_date_time.local_time();
-    boost::gregorian::date date = origin_pt.date();
+    boost::gregorian::date date = origin.local.date();
     std::stringstream ss_time;
-    ss_time << origin_pt.time_of_day();
+    ss_time << origin.local.time_of_day();
     std::string time = ss_time.str();
 
     std::size_t found = time.find_last_of(":"); // remove seconds.
@@ -480,9 +663,7 @@ void seconds_to_date(const bool is_depart_at,
       time = time.substr(0,found);
 
     ss_time.str("");
-    if (origin_date_time.is_dst())
-      ss_time << origin_tz->dst_offset() + origin_tz->base_utc_offset();
-    else ss_time << origin_tz->base_utc_offset();
+    ss_time << origin.offset;
 
     //postive tz
     if (ss_time.str().find("+") == std::string::npos && ss_time.str().find("-") == std::string::npos)
@@ -493,10 +674,9 @@ void seconds_to_date(const bool is_depart_at,
     if (found != std::string::npos)
       iso_origin = iso_origin.substr(0,found);
 
-    dest_pt = dest_date_time.local_time();
-    date = dest_pt.date();
+    date = dest.local.date();
     ss_time.str("");
-    ss_time << dest_pt.time_of_day();
+    ss_time << dest.local.time_of_day();
     time = ss_time.str();
 
     found = time.find_last_of(":"); // remove seconds.
@@ -504,9 +684,7 @@ void seconds_to_date(const bool is_depart_at,
       time = time.substr(0,found);
 
     ss_time.str("");
-    if (dest_date_time.is_dst())
-      ss_time << dest_tz->dst_offset() + dest_tz->base_utc_offset();
-    else ss_time << dest_tz->base_utc_offset();
+    ss_time << dest.offset;
 
     //postive tz
     if (ss_time.str().find("+") == std::string::npos && ss_time.str().find("-") == std::string::npos)
@@ -529,32 +707,8 @@ uint32_t day_of_week_mask(const std::string& date_time) {
   if (date < pivot_date_)
     return kDOWNone;
 
-  boost::gregorian::greg_weekday wd = date.day_of_week();
-
-  switch (wd.as_enum()) {
-    case boost::date_time::Sunday:
-      return kSunday;
-      break;
-    case boost::date_time::Monday:
-      return kMonday;
-      break;
-    case boost::date_time::Tuesday:
-      return kTuesday;
-      break;
-    case boost::date_time::Wednesday:
-      return kWednesday;
-      break;
-    case boost::date_time::Thursday:
-      return kThursday;
-      break;
-    case boost::date_time::Friday:
-      return kFriday;
-      break;
-    case boost::date_time::Saturday:
-      return kSaturday;
-      break;
-  }
-  return kDOWNone;
+  //kSunday through kSaturday are the bits of the days of the week
+  return 1 << date.day_of_week().as_number();
 }
 
 //Get the number of seconds midnight that have elapsed.
@@ -564,6 +718,10 @@ uint32_t seconds_from_midnight(const std::string& date_time) {
   //please see GTFS spec:
   //https://developers.google.com/transit/gtfs/reference#stop_times_fields
 
+  date_time_fields_t fields;
+  if (parse_date_time(date_time, fields) && fields.has_time)
+    return fields.hour * 3600 + fields.minute * 60 + fields.second;
+
   boost::posix_time::time_duration td;
   std::size_t found = date_time.find("T"); // YYYY-MM-DDTHH:MM
   if (found != std::string::npos)
@@ -643,10 +801,6 @@ std::string get_duration(const std::string& date_time, const uint32_t seconds,
 
 // checks if string is in the format of %Y-%m-%dT%H:%M
 bool is_iso_local(const std::string& date_time) {
-
-  std::stringstream ss("");
-  bool is_ok = true;
-
   if (date_time.size() != 16)//YYYY-MM-DDTHH:MM
     return false;
 
@@ -654,27 +808,12 @@ bool is_iso_local(const std::string& date_time) {
       date_time.at(10) != 'T' || date_time.at(13) != ':')
     return false;
 
-  try {
-    boost::local_time::local_time_input_facet* input_facet = new boost::local_time::local_time_input_facet();
-    input_facet->format("%Y-%m-%dT%H:%M");
-
-    ss.imbue(std::locale(ss.getloc(), input_facet));
-    boost::posix_time::ptime pt;
-    ss.str(date_time);
-    is_ok = static_cast<bool>(ss >> pt);
-
-    std::size_t found = date_time.find("T"); //YYYY-MM-DDTHH:MM
-    std::string time = date_time.substr(found+1);
-    uint32_t hour = std::stoi(time.substr(0,2));
-    uint32_t min = std::stoi(time.substr(3));
-
-    if (hour > 23 || min > 59)
-      return false;
-
-  } catch (std::exception& e){
-    return false;
-  }
-  return is_ok;
+  //boost dates only go from 1400 to 9999
+  date_time_fields_t fields;
+  return parse_date_time(date_time, fields) &&
+         fields.year >= 1400 && fields.month >= 1 && fields.month <= 12 && fields.day >= 1 &&
+         fields.day <= boost::gregorian::gregorian_calendar::end_of_month_day(fields.year, fields.month) &&
+         fields.hour <= 23 && fields.minute <= 59;
 }
 
 }
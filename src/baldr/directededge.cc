@@ -30,6 +30,29 @@ json::MapPtr access_json(uint32_t access) {
   });
 }
 
+void bike_network_json(uint8_t mask, json::StreamWriter& writer) {
+  writer.start_map();
+  writer("national", static_cast<bool>(mask & kNcn));
+  writer("regional", static_cast<bool>(mask & kRcn));
+  writer("local", static_cast<bool>(mask & kLcn));
+  writer("mountain", static_cast<bool>(mask & kMcn));
+  writer.end_map();
+}
+
+void access_json(uint32_t access, json::StreamWriter& writer) {
+  writer.start_map();
+  writer("bicycle", static_cast<bool>(access & kBicycleAccess));
+  writer("bus", static_cast<bool>(access & kBusAccess));
+  writer("car", static_cast<bool>(access & kAutoAccess));
+  writer("emergency", static_cast<bool>(access & kEmergencyAccess));
+  writer("HOV", static_cast<bool>(access & kHOVAccess));
+  writer("pedestrian", static_cast<bool>(access & kPedestrianAccess));
+  writer("taxi", static_cast<bool>(access & kTaxiAccess));
+  writer("truck", static_cast<bool>(access & kTruckAccess));
+  writer("wheelchair", static_cast<bool>(access & kWheelchairAccess));
+  writer.end_map();
+}
+
 /**
  * Get the updated bit field.
  * @param dst  Data member to be updated.
@@ -597,6 +620,52 @@ json::MapPtr DirectedEdge::json() const {
   });
 }
 
+void DirectedEdge::json(json::StreamWriter& writer) const {
+  writer.start_map();
+  writer.key("end_node");
+  endnode().json(writer);
+  writer("speed", static_cast<uint64_t>(speed_));
+  writer("access_restriction", static_cast<bool>(access_restriction_));
+  writer.key("start_restriction");
+  access_json(start_restriction_, writer);
+  writer.key("end_restriction");
+  access_json(end_restriction_, writer);
+  writer("part_of_complex_restriction", static_cast<bool>(part_of_complex_restriction_));
+  writer("has_exit_sign", static_cast<bool>(exitsign_));
+  writer("drive_on_right", static_cast<bool>(drive_on_right_));
+  writer("toll", static_cast<bool>(toll_));
+  writer("seasonal", static_cast<bool>(seasonal_));
+  writer("destination_only", static_cast<bool>(dest_only_));
+  writer("tunnel", static_cast<bool>(tunnel_));
+  writer("bridge", static_cast<bool>(bridge_));
+  writer("round_about", static_cast<bool>(roundabout_));
+  writer("unreachable", static_cast<bool>(unreachable_));
+  writer("traffic_signal", static_cast<bool>(traffic_signal_));
+  writer("forward", static_cast<bool>(forward_));
+  writer("not_thru", static_cast<bool>(not_thru_));
+  writer("cycle_lane", to_string(static_cast<CycleLane>(cycle_lane_)));
+  writer.key("bike_network");
+  bike_network_json(bike_network_, writer);
+  writer("truck_route", static_cast<bool>(truck_route_));
+  writer("lane_count", static_cast<uint64_t>(lanecount_));
+  writer("use", to_string(static_cast<Use>(use_)));
+  writer("speed_type", to_string(static_cast<SpeedType>(speed_type_)));
+  writer("country_crossing", static_cast<bool>(ctry_crossing_));
+  writer.key("geo_attributes").start_map();
+  writer("length", static_cast<uint64_t>(length_));
+  writer("weighted_grade", json::fp_t{static_cast<double>(weighted_grade_ - 6.0) / .6, 2});
+  writer.end_map();
+  writer.key("access");
+  access_json(forwardaccess_, writer);
+  writer.key("classification").start_map();
+  writer("classification", to_string(static_cast<RoadClass>(classification_)));
+  writer("surface", to_string(static_cast<Surface>(surface_)));
+  writer("link", static_cast<bool>(link_));
+  writer("internal", static_cast<bool>(internal_));
+  writer.end_map();
+  writer.end_map();
+}
+
 
 }
 }
@@ -1,5 +1,8 @@
 #include "baldr/double_bucket_queue.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace valhalla {
 namespace baldr {
 
@@ -7,24 +10,18 @@ namespace baldr {
 // bucket sort, and a bucket size. All costs above mincost + range are
 // stored in an "overflow" bucket.
 DoubleBucketQueue::DoubleBucketQueue(const float mincost, const float range,
-          const uint32_t bucketsize, const LabelCost& labelcost) {
-  // Adjust min cost to be the start of a bucket
-  uint32_t c = static_cast<uint32_t>(mincost);
-  currentcost_ = (c - (c % bucketsize));
-  mincost_ = currentcost_;
+          const uint32_t bucketsize, const LabelCost& labelcost,
+          const bool lazydecrease, const uint32_t maxbucketsize)
+    : lazydecrease_(lazydecrease), initialrange_(range),
+      initialsize_(bucketsize), maxbucketsize_(maxbucketsize), stats_() {
+  startcost_ = mincost;
   bucketrange_ = range;
   bucketsize_ = static_cast<float>(bucketsize);
   inv_ = 1.0f / bucketsize_;
 
-  // Set the maximum cost (above this goes into the overflow bucket)
-  maxcost_ = mincost + bucketrange_;
-
-  // Allocate the low-level buckets
-  bucketcount_ = (range / bucketsize_) + 1;
-  buckets_.resize(bucketcount_);
-
-  // Set the current bucket to the lowest cost low level bucket
-  currentbucket_ = buckets_.begin();
+  // Allocate the low-level buckets and set the current bucket to the
+  // lowest cost low level bucket
+  reset_range();
 
   // Set the cost function.
   labelcost_ = labelcost;
@@ -32,7 +29,6 @@ DoubleBucketQueue::DoubleBucketQueue(const float mincost, const float range,
 
 // Destructor
 DoubleBucketQueue::~DoubleBucketQueue() {
-  clear();
 }
 
 // Clear all labels from the low-level buckets and the overflow buckets.
@@ -43,20 +39,94 @@ void DoubleBucketQueue::clear() {
     currentbucket_->clear();
     currentbucket_++;
   }
+  label_buckets_.clear();
+
+  // Adapt the layout to the last query and reset the cost range
+  if (maxbucketsize_ > 0) {
+    adapt();
+  }
+  reset_range();
+}
+
+// Reset the statistics.
+void DoubleBucketQueue::reset_stats() {
+  stats_ = BucketQueueStats();
+}
 
-  // Reset current bucket and cost
+// Set the cost range to start at the minimum cost.
+void DoubleBucketQueue::reset_range() {
+  // Adjust min cost to be the start of a bucket
+  uint32_t c = static_cast<uint32_t>(startcost_);
+  uint32_t size = static_cast<uint32_t>(bucketsize_);
+  mincost_ = (c - (c % size));
+
+  // Set the maximum cost (above this goes into the overflow bucket)
+  maxcost_ = startcost_ + bucketrange_;
   currentcost_ = mincost_;
+  querycost_ = mincost_;
+  resize_buckets();
+}
+
+// Resize the low level buckets to cover the cost range.
+void DoubleBucketQueue::resize_buckets() {
+  uint32_t count = static_cast<uint32_t>(std::ceil((maxcost_ - mincost_) * inv_)) + 1;
+  if (count != buckets_.size()) {
+    buckets_.resize(count);
+  }
   currentbucket_ = buckets_.begin();
 }
 
+// Pick the range and bucket size for the next query.
+void DoubleBucketQueue::adapt() {
+  // Nothing to learn from an empty query
+  float needed = querycost_ - startcost_;
+  if (needed <= 0.0f) {
+    return;
+  }
+
+  // Double the initial range until it covers the costs popped in the last
+  // query. Double the bucket size while that takes too many buckets.
+  float range = initialrange_;
+  while (range < needed) {
+    range *= 2.0f;
+  }
+  uint32_t size = initialsize_;
+  while (range / size > kMaxAdaptiveBuckets && size * 2 <= maxbucketsize_) {
+    size *= 2;
+  }
+  range = std::min(range, static_cast<float>(kMaxAdaptiveBuckets) * size);
+
+  // Grow right away but only shrink when the range is 4 times too large
+  // so queries of varying length do not resize every time
+  if (range > bucketrange_ || range * 4.0f <= bucketrange_ ||
+      size != static_cast<uint32_t>(bucketsize_)) {
+    bucketrange_ = range;
+    bucketsize_ = static_cast<float>(size);
+    inv_ = 1.0f / bucketsize_;
+    stats_.resizes++;
+  }
+}
+
 // The specified label now has a smaller cost.  Reorders it in the sorted list
 void DoubleBucketQueue::decrease(const uint32_t label, const float newcost,
                                  const float previouscost) {
+  // With lazy decrease the label is added to its new bucket and the entry
+  // left in its previous bucket is skipped when popped.
+  stats_.decreases++;
+  uint32_t newidx = bucket_index(newcost);
+  if (lazydecrease_) {
+    if (label >= label_buckets_.size() || label_buckets_[label] != newidx) {
+      get_bucket(newidx).push_back(label);
+      track(label, newidx);
+    }
+    return;
+  }
+
   // Get the buckets of the previous and new costs. Nothing needs to be done
   // if old cost and the new cost are in the same buckets.
-  auto& prevbucket = get_bucket(previouscost);
-  auto& newbucket  = get_bucket(newcost);
-  if (prevbucket != newbucket) {
+  auto& prevbucket = get_bucket(bucket_index(previouscost));
+  auto& newbucket  = get_bucket(newidx);
+  if (&prevbucket != &newbucket) {
     // Remove the label index from the old bucket and add to end of newbucket
     for (auto it = prevbucket.begin(); it != prevbucket.end(); ++it) {
       if (*it == label) {
@@ -70,39 +140,43 @@ void DoubleBucketQueue::decrease(const uint32_t label, const float newcost,
 
 // Remove the label with the lowest cost
 uint32_t DoubleBucketQueue::pop() {
-  const auto nextlabel = [this]() {
-    uint32_t label = currentbucket_->front();
-    currentbucket_->pop_front();
-    return label;
-  };
-
   // Return a label from lowest non-empty bucket.
-  for ( ; currentbucket_ != buckets_.end(); currentbucket_++,
-          currentcost_ += bucketsize_) {
-    if (!currentbucket_->empty()) {
-      return nextlabel();
-    }
+  uint32_t label = pop_bucket();
+
+  // No labels found in the low-level buckets. Move labels from the overflow
+  // bucket to the low level buckets and try again.
+  while (label == kInvalidLabel && !overflowbucket_.empty()) {
+    empty_overflow();
+    currentbucket_ = buckets_.begin();
+    label = pop_bucket();
   }
+  return label;
+}
 
-  // No labels found in the low-level buckets. Return an invalid label if no
-  // labels are in the overflow buckets
-  if (overflowbucket_.empty()) {
-    // Reset currentbucket to the last bucket - in case another access of
-    // adjacency list is done
-    currentbucket_--;
-    return kInvalidLabel;
-  }
+// Remove the label with the lowest cost from the low level buckets
+uint32_t DoubleBucketQueue::pop_bucket() {
+  for ( ; currentbucket_ != buckets_.end(); currentbucket_++,
+          currentcost_ += bucketsize_) {
+    while (!currentbucket_->empty()) {
+      uint32_t label = currentbucket_->front();
+      currentbucket_->pop_front();
+      if (!lazydecrease_) {
+        return popped(label);
+      }
 
-  // Move labels from the overflow bucket to the low level buckets. Then find
-  // smallest bucket that is not empty and set it as the currentbucket and
-  // return its first label.
-  empty_overflow();
-  for (currentbucket_ = buckets_.begin(); currentbucket_ != buckets_.end();
-           currentbucket_++, currentcost_ += bucketsize_) {
-    if (!currentbucket_->empty()) {
-      return nextlabel();
+      // Skip labels that have since moved to a lower bucket or were popped
+      uint32_t idx = currentbucket_ - buckets_.begin();
+      if (label_buckets_[label] == idx) {
+        label_buckets_[label] = kInvalidLabel;
+        return popped(label);
+      }
+      stats_.stale++;
     }
   }
+
+  // Reset currentbucket to the last bucket - in case another access of
+  // adjacency list is done
+  currentbucket_--;
   return kInvalidLabel;
 }
 
@@ -112,20 +186,39 @@ void DoubleBucketQueue::empty_overflow() {
   bool found = false;
   std::vector<uint32_t> tmp;
   while (!found && !overflowbucket_.empty()) {
-    // Adjust cost range
+    // Adjust cost range. An adaptive queue doubles the range while it can
+    // (all low level buckets are empty here).
+    uint32_t overflowidx = buckets_.size();
     mincost_ += bucketrange_;
+    if (maxbucketsize_ > 0 && bucketrange_ * 2.0f * inv_ <= kMaxAdaptiveBuckets) {
+      bucketrange_ *= 2.0f;
+      stats_.resizes++;
+    }
     maxcost_ += bucketrange_;
     currentcost_ = mincost_;
+    resize_buckets();
+    stats_.range_shifts++;
 
     tmp.clear();
     while (!overflowbucket_.empty()) {
       uint32_t label = overflowbucket_.front();
       overflowbucket_.pop_front();
+      stats_.overflow_scans++;
+
+      // Drop labels that have since moved to a low level bucket
+      if (lazydecrease_ && label_buckets_[label] != overflowidx) {
+        stats_.stale++;
+        continue;
+      }
 
       // Get the cost (using the label cost function)
       float cost = labelcost_(label);
       if (cost < maxcost_) {
-        buckets_[static_cast<uint32_t>((cost-mincost_)*inv_)].push_back(label);
+        uint32_t idx = static_cast<uint32_t>((cost-mincost_)*inv_);
+        buckets_[idx].push_back(label);
+        if (lazydecrease_) {
+          label_buckets_[label] = idx;
+        }
         found = true;
       } else {
         tmp.push_back(label);
@@ -136,10 +229,12 @@ void DoubleBucketQueue::empty_overflow() {
     overflowbucket_.clear();
     for (auto label : tmp) {
       overflowbucket_.push_back(label);
+      if (lazydecrease_) {
+        label_buckets_[label] = buckets_.size();
+      }
     }
   }
 }
 
 }
 }
-
@@ -1,5 +1,6 @@
 #include "baldr/edgeinfo.h"
 
+#include <cstring>
 #include <valhalla/midgard/encoded.h>
 
 using namespace valhalla::baldr;
@@ -13,14 +14,123 @@ json::ArrayPtr names_json(const std::vector<std::string>& names) {
   return a;
 }
 
+// every varint ends with a byte that doesnt have the continuation (high) bit
+// set so counting those tells us how many values are in the encoded shape.
+// we look at 8 bytes at a time by moving the high bits down to the low bit of
+// each byte and summing all the bytes with a single multiply
+size_t count_varints(const char* encoded, const size_t size) {
+  constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+  constexpr uint64_t kLowBits  = 0x0101010101010101ULL;
+  size_t count = 0, i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, encoded + i, sizeof(uint64_t));
+    count += ((((~word) & kHighBits) >> 7) * kLowBits) >> 56;
+  }
+  for (; i < size; ++i)
+    count += (encoded[i] & 0x80) == 0;
+  return count;
+}
+
+// decode a single zig-zagged varint, the caller guarantees it is terminated.
+// the bits are gathered and unzigzagged unsigned so that the fifth byte (a
+// shift of 28) can't overflow, bits past the 32nd of a malformed varint are
+// dropped
+inline int32_t next_varint(const char*& encoded) {
+  uint32_t byte = static_cast<unsigned char>(*encoded++);
+  uint32_t result = byte & 0x7f;
+  uint32_t shift = 7;
+  while (byte & 0x80) {
+    byte = static_cast<unsigned char>(*encoded++);
+    if (shift < 32)
+      result |= (byte & 0x7f) << shift;
+    shift += 7;
+  }
+  return static_cast<int32_t>((result >> 1) ^ (0u - (result & 1)));
+}
+
 }
 
 namespace valhalla {
 namespace baldr {
 
+std::vector<PointLL> decode_shape7(const char* encoded, const size_t size) {
+  // Each point is a lat and a lng value and the last one must be complete
+  size_t values = count_varints(encoded, size);
+  if ((values & 1) || (size > 0 && (encoded[size - 1] & 0x80)))
+    throw std::runtime_error("Bad encoded polyline");
+
+  // Allocate once then decode without checking bounds on every byte
+  std::vector<PointLL> shape(values / 2);
+  int32_t lat = 0, lon = 0;
+  for (auto& point : shape) {
+    lat += next_varint(encoded);
+    lon += next_varint(encoded);
+    point = PointLL(double(lon) * 1e-6, double(lat) * 1e-6);
+  }
+  return shape;
+}
+
+ShapeCache::ShapeCache(const size_t max_size)
+  : max_size_(max_size), memory_(0) {
+  shapes_.reserve(max_size_);
+}
+
+// Get the decoded shape, decoding and caching it if we havent seen it yet
+ShapeCache::shape_ptr ShapeCache::get(const uint32_t offset,
+                                      const char* encoded, const size_t size) {
+  auto cached = shapes_.find(offset);
+  if (cached != shapes_.end())
+    return cached->second;
+
+  // Flush everything when we are full. Anyone still using a shape keeps it
+  if (shapes_.size() >= max_size_)
+    clear();
+
+  shape_ptr shape = std::make_shared<const std::vector<PointLL> >(
+                      decode_shape7(encoded, size));
+  shapes_.emplace(offset, shape);
+  const size_t bytes = shape->size() * sizeof(PointLL);
+  memory_ += bytes;
+  if (total_)
+    *total_ += bytes;
+  return shape;
+}
+
+void ShapeCache::clear() {
+  shapes_.clear();
+  if (total_)
+    *total_ -= memory_;
+  memory_ = 0;
+}
+
+size_t ShapeCache::size() const {
+  return shapes_.size();
+}
+
+size_t ShapeCache::memory() const {
+  return memory_;
+}
+
+void ShapeCache::report_to(const std::shared_ptr<size_t>& total) {
+  if (total_)
+    *total_ -= memory_;
+  total_ = total;
+  if (total_)
+    *total_ += memory_;
+}
+
 EdgeInfo::EdgeInfo(char* ptr, const char* names_list,
                    const size_t names_list_length)
-  : names_list_(names_list), names_list_length_(names_list_length) {
+  : EdgeInfo(ptr, names_list, names_list_length, nullptr, 0) {
+}
+
+EdgeInfo::EdgeInfo(char* ptr, const char* names_list,
+                   const size_t names_list_length,
+                   ShapeCache* shape_cache,
+                   const uint32_t offset)
+  : names_list_(names_list), names_list_length_(names_list_length),
+    shape_cache_(shape_cache), offset_(offset) {
 
   wayid_ = *(reinterpret_cast<uint64_t*>(ptr));
   ptr += sizeof(uint64_t);
@@ -90,9 +200,18 @@ std::vector<std::string> EdgeInfo::GetNames() const {
 
 // Returns shape as a vector of PointLL
 const std::vector<PointLL>& EdgeInfo::shape() const {
-  //if we haven't yet decoded the shape, do so
-  if(encoded_shape_ != nullptr && shape_.empty())
-    shape_ = midgard::decode7<std::vector<PointLL> >(encoded_shape_, item_->encoded_shape_size);
+  //already have it from the cache
+  if(cached_shape_)
+    return *cached_shape_;
+
+  //if we haven't yet decoded the shape, do so (sharing it if we can)
+  if(encoded_shape_ != nullptr && shape_.empty()) {
+    if(shape_cache_) {
+      cached_shape_ = shape_cache_->get(offset_, encoded_shape_, item_->encoded_shape_size);
+      return *cached_shape_;
+    }
+    shape_ = decode_shape7(encoded_shape_, item_->encoded_shape_size);
+  }
   return shape_;
 }
 
@@ -109,5 +228,16 @@ json::MapPtr EdgeInfo::json() const {
   });
 }
 
+void EdgeInfo::json(json::StreamWriter& writer) const {
+  writer.start_map();
+  writer("way_id", static_cast<uint64_t>(wayid_));
+  writer.key("names").start_array();
+  for(const auto& n : GetNames())
+    writer.value(n);
+  writer.end_array();
+  writer("shape", midgard::encode(shape()));
+  writer.end_map();
+}
+
 }
 }
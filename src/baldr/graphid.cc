@@ -35,6 +35,18 @@ json::Value GraphId::json() const {
   return static_cast<std::nullptr_t>(nullptr);
 }
 
+void GraphId::json(json::StreamWriter& writer) const {
+  if(!Is_Valid()) {
+    writer.value(nullptr);
+    return;
+  }
+  writer.start_map();
+  writer("level", static_cast<uint64_t>(fields.level));
+  writer("tile_id", static_cast<uint64_t>(fields.tileid));
+  writer("id", static_cast<uint64_t>(fields.id));
+  writer.end_map();
+}
+
 // Stream output
 std::ostream& operator<<(std::ostream& os, const GraphId& id) {
   return os << id.fields.level << '/' << id.fields.tileid << '/' << id.fields.id;
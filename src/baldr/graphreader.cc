@@ -57,6 +57,7 @@ std::shared_ptr<const GraphReader::tile_extract_t> GraphReader::get_extract_inst
 GraphReader::GraphReader(const boost::property_tree::ptree& pt)
     : tile_hierarchy_(pt.get<std::string>("tile_dir")),
       cache_size_(0),
+      decoded_shapes_size_(std::make_shared<size_t>(0)),
       tile_extract_(get_extract_instance(pt)) {
   max_cache_size_ = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
 
@@ -123,6 +124,7 @@ const GraphTile* GraphReader::GetGraphTile(const GraphId& graphid) {
 
     // Keep a copy in the cache and return it
     cache_size_ += AVERAGE_MM_TILE_SIZE; // tile.end_offset();  // TODO what size??
+    tile.track_decoded_shapes(decoded_shapes_size_);
     auto inserted = cache_.emplace(base, std::move(tile));
     return &inserted.first->second;
   }// Try getting it from flat file
@@ -134,6 +136,7 @@ const GraphTile* GraphReader::GetGraphTile(const GraphId& graphid) {
 
     // Keep a copy in the cache and return it
     cache_size_ += tile.header()->end_offset();
+    tile.track_decoded_shapes(decoded_shapes_size_);
     auto inserted = cache_.emplace(base, std::move(tile));
     return &inserted.first->second;
   }
@@ -156,11 +159,16 @@ const TileHierarchy& GraphReader::GetTileHierarchy() const {
 void GraphReader::Clear() {
   cache_size_ = 0;
   cache_.clear();
+  // Copies of the cleared tiles may still decode shapes, they keep the old
+  // total to themselves
+  decoded_shapes_size_ = std::make_shared<size_t>(0);
 }
 
-// Returns true if the cache is over committed with respect to the limit
+// Returns true if the cache is over committed with respect to the limit.
+// The tiles' decoded shapes grow as they are used, the tiles keep their
+// total up to date as they go
 bool GraphReader::OverCommitted() const {
-  return max_cache_size_ < cache_size_;
+  return max_cache_size_ < cache_size_ + *decoded_shapes_size_;
 }
 
 // Convenience method to get an opposing directed edge graph Id.
@@ -188,8 +196,11 @@ GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, const GraphTile*&
   }
 
   if (tile != nullptr) {
-    id.fields.id = tile->node(id)->edge_index() + directededge->opp_index();
-    return id;
+    const auto edges = tile->edges(id);
+    if (directededge->opp_index() < edges.size())
+      return (*(edges.begin() + directededge->opp_index())).first;
+    LOG_ERROR("Invalid opposing edge index: " + std::to_string(directededge->opp_index()) +
+              " of " + std::to_string(edges.size()) + " edges");
   } else {
     LOG_ERROR("Invalid tile for opposing edge: tile ID= " + std::to_string(id.tileid()) + " level= " + std::to_string(id.level()));
     if (directededge->trans_up() || directededge->trans_down()) {
@@ -13,6 +13,7 @@
 #include <locale>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 
 namespace {
@@ -171,6 +172,8 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr,
   // Start of edge information and its size
   edgeinfo_ = tile_ptr + header_->edgeinfo_offset();
   edgeinfo_size_ = header_->textlist_offset() - header_->edgeinfo_offset();
+  shape_cache_ = std::make_shared<ShapeCache>();
+  way_edges_ = std::make_shared<way_index_t>();
 
   // Start of text list and its size
   textlist_ = tile_ptr + header_->textlist_offset();
@@ -187,12 +190,40 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr,
 
   // ANY NEW EXPANSION DATA GOES HERE
 
-  // Associate one stop Ids for transit tiles
+  // Index departures by line Id and associate one stop Ids for transit tiles
   if (graphid.level() == 3) {
+    IndexDepartures();
     AssociateOneStopIds(graphid);
   }
 }
 
+// Departures are sorted by line Id and then by departure time, so the
+// departures of each line form a contiguous range. Record that range per
+// line Id so lookups do not need to search the whole departure list.
+void GraphTile::IndexDepartures() {
+  line_departures_.clear();
+  uint32_t count = header_->departurecount();
+  if (count == 0) {
+    return;
+  }
+  line_departures_.resize(departures_[count - 1].lineid() + 1, {0, 0, false});
+  uint32_t begin = 0;
+  bool frequency = false;
+  for (uint32_t i = 0; i < count; i++) {
+    frequency = frequency || departures_[i].type() == kFrequencySchedule;
+    if (i + 1 == count || departures_[i + 1].lineid() != departures_[begin].lineid()) {
+      uint32_t lineid = departures_[begin].lineid();
+      if (lineid >= line_departures_.size() || line_departures_[lineid].end != 0) {
+        LOG_ERROR("Departures are not sorted by lineid = " + std::to_string(lineid));
+      } else {
+        line_departures_[lineid] = {begin, i + 1, frequency};
+      }
+      begin = i + 1;
+      frequency = false;
+    }
+  }
+}
+
 // For transit tiles we need to save off the pair<tileid,lineid> lookup via
 // onestop_ids.  This will be used for including or excluding transit lines
 // for transit routes.  We save 2 maps because operators contain all of their
@@ -382,7 +413,18 @@ GraphId GraphTile::GetOpposingEdgeId(const DirectedEdge* edge) const {
 
 // Get a pointer to edge info.
 EdgeInfo GraphTile::edgeinfo(const size_t offset) const {
-  return EdgeInfo(edgeinfo_ + offset, textlist_, textlist_size_);
+  return EdgeInfo(edgeinfo_ + offset, textlist_, textlist_size_,
+                  shape_cache_.get(), offset);
+}
+
+// Get the memory used by the decoded shapes
+size_t GraphTile::decoded_shapes_size() const {
+  return shape_cache_ ? shape_cache_->memory() : 0;
+}
+
+void GraphTile::track_decoded_shapes(const std::shared_ptr<size_t>& total) const {
+  if (shape_cache_)
+    shape_cache_->report_to(total);
 }
 
 // Get the complex restrictions in the forward or reverse order based on
@@ -413,14 +455,38 @@ std::vector<ComplexRestriction> GraphTile::GetRestrictions(const bool forward,
   return cr_vector;
 }
 
+// Get the range of directed edges outbound from the specified node.
+DirectedEdgeRange GraphTile::edges(const GraphId& node) const {
+  return edges(static_cast<size_t>(node.id()));
+}
+
+// Get the range of directed edges outbound from the specified node index.
+// Bounds are checked once here rather than for every edge.
+DirectedEdgeRange GraphTile::edges(const size_t node_index) const {
+  const NodeInfo* nodeinfo = node(node_index);
+  const uint32_t edge_index = nodeinfo->edge_index();
+  const uint32_t count = nodeinfo->edge_count();
+  if (edge_index + count > header_->directededgecount())
+    throw std::runtime_error("GraphTile DirectedEdge index out of bounds: " +
+                             std::to_string(header_->graphid().tileid()) + "," +
+                             std::to_string(header_->graphid().level()) + "," +
+                             std::to_string(edge_index + count)  + " directededgecount= " +
+                             std::to_string(header_->directededgecount()));
+  return DirectedEdgeRange(directededges_ + edge_index, count,
+                           { header_->graphid().tileid(), header_->graphid().level(), edge_index });
+}
+
 // Get the directed edges outbound from the specified node index.
 const DirectedEdge* GraphTile::GetDirectedEdges(const uint32_t node_index,
                                                 uint32_t& count,
                                                 uint32_t& edge_index) const {
-  const NodeInfo* nodeinfo = node(node_index);
-  count = nodeinfo->edge_count();
-  edge_index = nodeinfo->edge_index();
-  return directededge(nodeinfo->edge_index());
+  // Validate the whole range of edges rather than only the first one. The
+  // first edge is only computed from, not read, so an empty range is fine
+  const auto range = edges(static_cast<size_t>(node_index));
+  const auto first = *range.begin();
+  count = range.size();
+  edge_index = first.first.id();
+  return first.second;
 }
 
 // Convenience method to get the names for an edge given the offset to the
@@ -429,6 +495,45 @@ std::vector<std::string> GraphTile::GetNames(const uint32_t edgeinfo_offset) con
   return edgeinfo(edgeinfo_offset).GetNames();
 }
 
+// Get the directed edges within this tile that lie on the given OSM way.
+std::vector<GraphId> GraphTile::GetEdgesForWay(const uint64_t wayid) const {
+  const auto& index = way_edges();
+  WayEdge key{wayid, 0, 0};
+  std::vector<GraphId> edges;
+  for (auto itr = std::lower_bound(index.cbegin(), index.cend(), key);
+       itr != index.cend() && itr->wayid == wayid; ++itr)
+    edges.emplace_back(header_->graphid().tileid(), header_->graphid().level(), itr->edgeid);
+  return edges;
+}
+
+// Get the OSM way Ids that have edges in this tile.
+std::vector<uint64_t> GraphTile::GetWayIds() const {
+  std::vector<uint64_t> wayids;
+  for (const auto& way_edge : way_edges()) {
+    if (wayids.empty() || wayids.back() != way_edge.wayid)
+      wayids.push_back(way_edge.wayid);
+  }
+  return wayids;
+}
+
+// Get the way Id index, building it on first use.
+const std::vector<WayEdge>& GraphTile::way_edges() const {
+  std::call_once(way_edges_->built, [this]() {
+    auto& index = way_edges_->edges;
+    index.reserve(header_->directededgecount());
+    for (uint32_t i = 0; i < header_->directededgecount(); i++) {
+      const DirectedEdge& edge = directededges_[i];
+      if (edge.is_shortcut() || edge.trans_up() || edge.trans_down() ||
+          edge.IsTransitLine())
+        continue;
+      uint32_t offset = edge.edgeinfo_offset();
+      index.push_back({edgeinfo(offset).wayid(), offset, i});
+    }
+    std::sort(index.begin(), index.end());
+  });
+  return way_edges_->edges;
+}
+
 // Get the admininfo at the specified index.
 AdminInfo GraphTile::admininfo(const size_t idx) const {
   if (idx < header_->admincount()) {
@@ -501,92 +606,136 @@ std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx) const {
   return signs;
 }
 
+// Get all the departures of a transit line.
+midgard::iterable_t<const TransitDeparture> GraphTile::GetDepartures(const uint32_t lineid) const {
+  if (lineid >= line_departures_.size()) {
+    return iterable_t<const TransitDeparture>{departures_, departures_};
+  }
+  const auto& range = line_departures_[lineid];
+  return iterable_t<const TransitDeparture>{departures_ + range.begin, departures_ + range.end};
+}
+
+// Get the first departure of a line that can depart at or after the time.
+const TransitDeparture* GraphTile::LowerBound(const uint32_t lineid,
+                                              const uint32_t current_time) const {
+  auto departures = GetDepartures(lineid);
+  if (lineid < line_departures_.size() && line_departures_[lineid].frequency) {
+    return departures.begin();
+  }
+  return std::lower_bound(departures.begin(), departures.end(), current_time,
+             [](const TransitDeparture& dep, const uint32_t time) {
+               return dep.departure_time() < time;
+             });
+}
+
 // Get the next departure given the directed line Id and the current
 // time (seconds from midnight).
 const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
                  const uint32_t current_time, const uint32_t day,
                  const uint32_t dow, bool date_before_tile,
                  bool wheelchair, bool bicycle) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
-    return nullptr;
-  }
+  uint32_t departure_time;
+  return GetNextDeparture(lineid, current_time, day, dow, date_before_tile,
+                          wheelchair, bicycle, departure_time);
+}
 
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count-1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    //matching lineid and a workable time
-    if (lineid == dep.lineid() && current_time <= dep.departure_time()) {
-      found = mid;
-      high = mid - 1;
-    }//need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    }//either need a bigger lineid or a later time
-    else {
-      low = mid + 1;
+// Get the next departure and its departure time given the directed line Id
+// and the current time (seconds from midnight).
+const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
+                 const uint32_t current_time, const uint32_t day,
+                 const uint32_t dow, bool date_before_tile,
+                 bool wheelchair, bool bicycle,
+                 uint32_t& departure_time) const {
+  // Iterate through departures to find the earliest with valid date, dow or
+  // calendar date, and that does not have a calendar exception. Departures
+  // are sorted by (start) time so none after the one found can be earlier.
+  const TransitDeparture* next = nullptr;
+  departure_time = kInvalidDepartureTime;
+  auto departures = GetDepartures(lineid);
+  for (auto dep = LowerBound(lineid, current_time);
+       dep != departures.end() && dep->departure_time() < departure_time; ++dep) {
+    uint32_t time = dep->next_departure_time(current_time);
+    if (time < departure_time &&
+      GetTransitSchedule(dep->schedule_index())->IsValid(day, dow, date_before_tile) &&
+      (!wheelchair || dep->wheelchair_accessible()) &&
+      (!bicycle || dep->bicycle_accessible())) {
+      next = dep;
+      departure_time = time;
     }
   }
 
-  // Iterate through departures until one is found with valid date, dow or
-  // calendar date, and does not have a calendar exception.
-  for(; found < count && departures_[found].lineid() == lineid; ++found) {
-    // Make sure valid departure time
-    if (departures_[found].departure_time() >= current_time &&
-      GetTransitSchedule(departures_[found].schedule_index())->IsValid(day, dow, date_before_tile) &&
-      (!wheelchair || departures_[found].wheelchair_accessible()) &&
-      (!bicycle || departures_[found].bicycle_accessible())) {
-      return &departures_[found];
+  // TODO - maybe wrap around, try next day?
+  if (next == nullptr) {
+    LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
+             " current_time = " + std::to_string(current_time));
+  }
+  return next;
+}
+
+// Get all valid departures of a transit line within a time window.
+std::vector<const TransitDeparture*> GraphTile::GetDeparturesInWindow(
+                 const uint32_t lineid, const uint32_t start_time,
+                 const uint32_t end_time, const uint32_t day,
+                 const uint32_t dow, bool date_before_tile,
+                 bool wheelchair, bool bicycle) const {
+  std::vector<const TransitDeparture*> found;
+  bool frequency = false;
+  auto departures = GetDepartures(lineid);
+  for (auto dep = LowerBound(lineid, start_time);
+       dep != departures.end() && dep->departure_time() <= end_time; ++dep) {
+    uint32_t time = dep->next_departure_time(start_time);
+    if (time <= end_time &&
+      GetTransitSchedule(dep->schedule_index())->IsValid(day, dow, date_before_tile) &&
+      (!wheelchair || dep->wheelchair_accessible()) &&
+      (!bicycle || dep->bicycle_accessible())) {
+      found.push_back(dep);
+      frequency = frequency || dep->type() == kFrequencySchedule;
     }
   }
 
-  // TODO - maybe wrap around, try next day?
-  LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
-           " current_time = " + std::to_string(current_time));
-  return nullptr;
+  // Frequency based departures may first depart later than their start time
+  if (frequency) {
+    std::stable_sort(found.begin(), found.end(),
+      [start_time](const TransitDeparture* a, const TransitDeparture* b) {
+        return a->next_departure_time(start_time) < b->next_departure_time(start_time);
+      });
+  }
+  return found;
+}
+
+// Get which transit schedules of the tile are valid on a day.
+void GraphTile::GetValidSchedules(const uint32_t day, const uint32_t dow,
+                 bool date_before_tile, std::vector<uint8_t>& valid) const {
+  valid.resize(header_->schedulecount());
+  TransitSchedule::IsValid(transit_schedules_, valid.size(), day, dow,
+                           date_before_tile, valid.data());
+}
+
+// Get the valid departures of a range of departures.
+void GraphTile::FilterDepartures(midgard::iterable_t<const TransitDeparture> departures,
+                 const std::vector<uint8_t>& valid_schedules,
+                 bool wheelchair, bool bicycle,
+                 std::vector<const TransitDeparture*>& found) {
+  for (const auto& dep : departures) {
+    uint32_t idx = dep.schedule_index();
+    if (idx < valid_schedules.size() && valid_schedules[idx] &&
+      (!wheelchair || dep.wheelchair_accessible()) &&
+      (!bicycle || dep.bicycle_accessible())) {
+      found.push_back(&dep);
+    }
+  }
 }
 
 // Get the departure given the line Id and tripid
 const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
                      const uint32_t tripid) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
-    return nullptr;
-  }
-
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count-1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    //find the first matching lineid in the list
-    if (lineid == dep.lineid()) {
-      found = mid;
-      high = mid - 1;
-    }//need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    }//need a bigger lineid
-    else {
-      low = mid + 1;
+  // Iterate through departures until one is found with matching trip id
+  for (const auto& dep : GetDepartures(lineid)) {
+    if (dep.tripid() == tripid) {
+      return &dep;
     }
   }
 
-  // Iterate through departures until one is found with matching trip id
-  for(; found < count && departures_[found].lineid() == lineid; ++found)
-    if (departures_[found].tripid() == tripid)
-      return &departures_[found];
-
   LOG_INFO("No departures found for lineid = " + std::to_string(lineid) +
            " and tripid = " + std::to_string(tripid));
   return nullptr;
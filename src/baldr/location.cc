@@ -1,13 +1,31 @@
+#include <algorithm>
+#include <limits>
 #include <stdexcept>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
-#include <boost/property_tree/json_parser.hpp>
 
 #include "baldr/location.h"
+#include "baldr/json_reader.h"
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/logging.h>
 #include <valhalla/midgard/util.h>
 
+namespace {
+
+// The text of the next value the way a property tree keeps it, maps and
+// arrays are skipped and have none
+valhalla::baldr::json::Slice text(valhalla::baldr::json::Reader& reader) {
+  auto type = reader.peek();
+  if(type == valhalla::baldr::json::Reader::Type::Map ||
+     type == valhalla::baldr::json::Reader::Type::Array) {
+    reader.skip();
+    return {"", 0};
+  }
+  return reader.scalar();
+}
+
+}
+
 namespace valhalla {
 namespace baldr {
 
@@ -90,11 +108,82 @@ Location Location::FromPtree(const boost::property_tree::ptree& pt) {
 }
 
 Location Location::FromJson(const std::string& json) {
-  std::stringstream stream;
-  stream << json;
-  boost::property_tree::ptree pt;
-  boost::property_tree::read_json(stream, pt);
-  return FromPtree(pt);
+  json::Reader reader(json);
+  auto location = FromJson(reader);
+  reader.finish();
+  return location;
+}
+
+Location Location::FromJson(json::Reader& reader) {
+  //same rules as FromPtree: the first of a repeated key wins, numbers may come
+  //as strings and anything else is taken as text (maps and arrays have none),
+  //integers which dont parse are left out
+  enum field_t { kLat, kLon, kType, kDateTime, kHeading, kWayId, kName, kStreet,
+                 kCity, kState, kPostalCode, kCountry, kFieldCount };
+  static const char* const kKeys[kFieldCount] = {"lat", "lon", "type", "date_time",
+    "heading", "way_id", "name", "street", "city", "state", "postal_code", "country"};
+  bool found[kFieldCount] = {};
+  float lat = 0, lon = 0;
+  Location location({0, 0});
+  reader.start_map();
+  json::Slice key;
+  while(reader.next_key(key)) {
+    size_t field = std::find_if(kKeys, kKeys + kFieldCount,
+      [&key](const char* k) { return key == k; }) - kKeys;
+    if(field == kFieldCount || found[field]) {
+      reader.skip();
+      continue;
+    }
+    found[field] = true;
+    auto value = text(reader);
+    switch(field) {
+      case kLat: lat = json::Reader::to_double(value); break;
+      case kLon: lon = json::Reader::to_double(value); break;
+      case kType: location.stoptype_ = value == "through" ? StopType::THROUGH : StopType::BREAK; break;
+      case kDateTime: location.date_time_ = value.str(); break;
+      case kHeading: {
+        int64_t heading;
+        if(json::Reader::to_integer(value, heading) &&
+           heading >= std::numeric_limits<int>::min() && heading <= std::numeric_limits<int>::max())
+          location.heading_ = static_cast<int>(heading);
+        break;
+      }
+      case kWayId: {
+        uint64_t way_id;
+        if(json::Reader::to_unsigned(value, way_id))
+          location.way_id_ = way_id;
+        break;
+      }
+      case kName: location.name_ = value.str(); break;
+      case kStreet: location.street_ = value.str(); break;
+      case kCity: location.city_ = value.str(); break;
+      case kState: location.state_ = value.str(); break;
+      case kPostalCode: location.zip_ = value.str(); break;
+      case kCountry: location.country_ = value.str(); break;
+    }
+  }
+
+  if(!found[kLat] || !found[kLon])
+    throw std::runtime_error("Location requires lat and lon");
+  if (lat < -90.0f || lat > 90.0f)
+    throw std::runtime_error("Latitude must be in the range [-90, 90] degrees");
+  location.latlng_ = midgard::PointLL(midgard::circular_range_clamp<float>(lon, -180, 180), lat);
+  return location;
+}
+
+std::vector<Location> Location::FromJsonArray(const std::string& json) {
+  json::Reader reader(json);
+  auto locations = FromJsonArray(reader);
+  reader.finish();
+  return locations;
+}
+
+std::vector<Location> Location::FromJsonArray(json::Reader& reader) {
+  std::vector<Location> locations;
+  reader.start_array();
+  while(reader.next_element())
+    locations.emplace_back(FromJson(reader));
+  return locations;
 }
 
 Location Location::FromCsv(const std::string& csv) {
@@ -1,7 +1,13 @@
 #include "baldr/merge.h"
 #include "baldr/graphreader.h"
 
+#include <algorithm>
 #include <boost/range/adaptor/map.hpp>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 namespace bra = boost::adaptors;
 
@@ -9,83 +15,6 @@ namespace valhalla {
 namespace baldr {
 namespace merge {
 
-namespace {
-
-uint64_t count_tiles_in_levels(GraphReader &reader) {
-  uint64_t tile_count = 0;
-  for (auto level : reader.GetTileHierarchy().levels() | bra::map_values) {
-    tile_count += level.tiles.ncolumns() * level.tiles.nrows();
-  }
-  return tile_count;
-}
-
-namespace iter {
-
-// the "edges" struct provides a container wrapper for the edges leaving a node
-// which is compatible with C++ range-based for loops and can make reading code
-// a bit nicer. for example:
-//
-//     for (const auto &pair : iter::edges(reader, node_id)) {
-//       ...
-//     }
-//
-// the iterator can be dereferenced into a pair of const DirectedEdge * and
-// GraphId. this allows iteration over both the edge and the ID of the edge,
-// which isn't directly obtainable from the DirectedEdge structure.
-struct edges {
-  struct const_iterator {
-    const DirectedEdge *ptr;
-    GraphId id;
-
-    const_iterator() : ptr(nullptr), id(0) {}
-    const_iterator(const DirectedEdge *p, GraphId i) : ptr(p), id(i) {}
-
-    const_iterator operator+(uint64_t i) const {
-      return const_iterator(ptr + i, id + i);
-    }
-
-    const_iterator &operator++() {
-      ++ptr;
-      id++;
-      return *this;
-    }
-
-    const_iterator operator++(int) {
-      const_iterator ret = *this;
-      ++(*this);
-      return ret;
-    }
-
-    std::pair<const DirectedEdge *const, GraphId> operator*() const {
-      return std::pair<const DirectedEdge *const, GraphId>(ptr, GraphId(id));
-    }
-
-    bool operator!=(const const_iterator &other) const {
-      return (ptr != other.ptr) || (id != other.id);
-    }
-  };
-
-  edges(GraphReader &reader, GraphId node_id) {
-    auto *tile = reader.GetGraphTile(node_id);
-    auto *node_info = tile->node(node_id);
-
-    auto edge_idx = node_info->edge_index();
-    m_begin = const_iterator(tile->directededge(edge_idx),
-                             node_id.Tile_Base() + uint64_t(edge_idx));
-    m_end = m_begin + node_info->edge_count();
-  }
-
-  const_iterator begin() const { return m_begin; }
-  const_iterator end()   const { return m_end; }
-
-private:
-  const_iterator m_begin, m_end;
-};
-
-} // namespace iter
-
-} // anonymous namespace
-
 namespace detail {
 
 bitset_t::bitset_t(size_t size) : bits(div_round_up(size, bits_per_value)) {}
@@ -94,51 +23,61 @@ void bitset_t::set(const uint64_t id) {
   if (id >= end_id()) {
     throw std::runtime_error("id out of bounds");
   }
-  bits[id / u64_size] |= u64_one << (id % u64_size);
+  bits[id / u64_size].fetch_or(u64_one << (id % u64_size), std::memory_order_relaxed);
 }
 
 bool bitset_t::get(const uint64_t id) const {
   if (id >= end_id()) {
     throw std::runtime_error("id out of bounds");
   }
-  return bits[id / u64_size] & (u64_one << (id % u64_size));
+  return bits[id / u64_size].load(std::memory_order_relaxed) & (u64_one << (id % u64_size));
 }
 
-bool edge_tracker::get(const GraphId &edge_id) const {
-  auto itr = m_edges_in_tiles.find(edge_id.Tile_Base());
-  assert(itr != m_edges_in_tiles.end());
-  return m_edge_set.get(edge_id.id() + itr->second);
+const uint64_t edge_tracker::no_tile;
+
+edge_tracker::edge_index_t edge_tracker::make_index(GraphReader &reader) {
+  edge_index_t index;
+  for (const auto &level : reader.GetTileHierarchy().levels() | bra::map_values) {
+    if (level.level >= index.size()) {
+      index.resize(level.level + 1);
+    }
+    index[level.level].resize(level.tiles.ncolumns() * level.tiles.nrows(), no_tile);
+  }
+  return index;
 }
 
-void edge_tracker::set(const GraphId &edge_id) {
-  auto itr = m_edges_in_tiles.find(edge_id.Tile_Base());
-  assert(itr != m_edges_in_tiles.end());
-  m_edge_set.set(edge_id.id() + itr->second);
+bool edge_tracker::before(const GraphId &a, const GraphId &b) const {
+  // the edge offsets of tiles increase in tile set order. tiles sharing an
+  // offset have no edges, so no collapsible nodes either. tiles outside the
+  // tile set have the largest offset, so sort last.
+  const auto offset_a = tile_offset(a);
+  const auto offset_b = tile_offset(b);
+  if (offset_a == no_tile) {
+    return false;
+  }
+  return offset_a < offset_b || (offset_a == offset_b && a.id() < b.id());
 }
 
-edge_collapser::edge_collapser(GraphReader &reader, edge_tracker &tracker, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path &)> func)
-  : m_reader(reader)
-  , m_tracker(tracker)
-  , m_edge_predictate(edge_pred)
-  , m_func(func)
-{}
+namespace {
 
 // returns the pair of nodes reachable from the given @node_id where they
 // are the only two nodes reachable by non-shortcut edges, and none of the
 // edges of @node_id cross into a different level.
-std::pair<GraphId, GraphId> edge_collapser::nodes_reachable_from(GraphId node_id) {
+std::pair<GraphId, GraphId> collapsible_neighbours(GraphReader &reader,
+                                                   const std::function<bool(const DirectedEdge *)> &edge_pred,
+                                                   GraphId node_id) {
   static const std::pair<GraphId, GraphId> none;
   GraphId first, second;
 
-  for (const auto &edge : iter::edges(m_reader, node_id)) {
+  for (const auto &edge : reader.GetGraphTile(node_id)->edges(node_id)) {
     // nodes which connect to ferries, transit or to a different level
     // shouldn't be collapsed.
-    if (!m_edge_predictate(edge.first)) {
+    if (!edge_pred(edge.second)) {
       return none;
     }
 
     // shortcut edges should be ignored
-    if (edge.first->shortcut()) {
+    if (edge.second->shortcut()) {
       continue;
     }
 
@@ -148,10 +87,10 @@ std::pair<GraphId, GraphId> edge_collapser::nodes_reachable_from(GraphId node_id
         return none;
 
       } else {
-        second = edge.first->endnode();
+        second = edge.second->endnode();
       }
     } else {
-      first = edge.first->endnode();
+      first = edge.second->endnode();
     }
   }
 
@@ -162,7 +101,9 @@ std::pair<GraphId, GraphId> edge_collapser::nodes_reachable_from(GraphId node_id
   }
 }
 
-GraphId edge_collapser::next_node_id(GraphId last_node_id, GraphId node_id) {
+GraphId next_in_chain(GraphReader &reader,
+                      const std::function<bool(const DirectedEdge *)> &edge_pred,
+                      GraphId last_node_id, GraphId node_id) {
   //
   //        -->--     -->--
   //   \   /  e4 \   /  e1 \   /
@@ -171,7 +112,7 @@ GraphId edge_collapser::next_node_id(GraphId last_node_id, GraphId node_id) {
   //        --<--     --<--
   //
   // given p (last_node_id) and c (node_id), return n if there is such a node.
-  auto nodes = nodes_reachable_from(node_id);
+  auto nodes = collapsible_neighbours(reader, edge_pred, node_id);
   if (!nodes.first || !nodes.second) {
     return GraphId();
   }
@@ -183,11 +124,36 @@ GraphId edge_collapser::next_node_id(GraphId last_node_id, GraphId node_id) {
   }
 }
 
+// turns the edges of a circular path so that it starts at its lowest edge,
+// and returns the node it then starts and ends at.
+GraphId rotate_to_lowest_edge(GraphReader &reader, std::vector<GraphId> &edges) {
+  std::rotate(edges.begin(), std::min_element(edges.begin(), edges.end()), edges.end());
+  const auto last = edges.back();
+  return reader.GetGraphTile(last)->directededge(last)->endnode();
+}
+
+} // anonymous namespace
+
+edge_collapser::edge_collapser(GraphReader &reader, edge_tracker &tracker, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path_view &)> func)
+  : m_reader(reader)
+  , m_tracker(tracker)
+  , m_edge_predictate(edge_pred)
+  , m_func(func)
+{}
+
+std::pair<GraphId, GraphId> edge_collapser::nodes_reachable_from(GraphId node_id) {
+  return collapsible_neighbours(m_reader, m_edge_predictate, node_id);
+}
+
+GraphId edge_collapser::next_node_id(GraphId last_node_id, GraphId node_id) {
+  return next_in_chain(m_reader, m_edge_predictate, last_node_id, node_id);
+}
+
 GraphId edge_collapser::edge_between(GraphId cur, GraphId next) {
   GraphId edge_id;
-  for (const auto &edge : iter::edges(m_reader, cur)) {
-    if (edge.first->endnode() == next) {
-      edge_id = edge.second;
+  for (const auto &edge : m_reader.GetGraphTile(cur)->edges(cur)) {
+    if (edge.second->endnode() == next) {
+      edge_id = edge.first;
       break;
     }
   }
@@ -195,6 +161,47 @@ GraphId edge_collapser::edge_between(GraphId cur, GraphId next) {
   return edge_id;
 }
 
+// returns true if @node_id is collapsible and comes first, in tile set
+// order, of the collapsible nodes along its path. a serial merge explores
+// each path from that node, so exploring only from it finds every path
+// exactly once without threads having to coordinate.
+//
+// both directions are walked in step so that the walk usually stops after a
+// few nodes, when one that comes earlier is found.
+bool edge_collapser::first_in_chain(GraphId node_id) {
+  auto nodes = nodes_reachable_from(node_id);
+  if (!nodes.first || !nodes.second) {
+    return false;
+  }
+
+  GraphId prev[2] = {node_id, node_id};
+  GraphId cur[2] = {nodes.first, nodes.second};
+  bool open[2] = {true, true};
+  while (open[0] || open[1]) {
+    for (int i = 0; i < 2; ++i) {
+      if (!open[i]) {
+        continue;
+      }
+      // circular, all the nodes have been seen
+      if (cur[i] == node_id) {
+        return true;
+      }
+      // the walk ends at a node which isn't collapsible
+      auto next = next_node_id(prev[i], cur[i]);
+      if (!next) {
+        open[i] = false;
+        continue;
+      }
+      if (m_tracker.before(cur[i], node_id)) {
+        return false;
+      }
+      prev[i] = cur[i];
+      cur[i] = next;
+    }
+  }
+  return true;
+}
+
 // explore starts walking the graph from a single node, building a forward and
 // reverse path of edges as long as the nodes found haven't been explored
 // before and have exactly two out-edges.
@@ -212,56 +219,310 @@ void edge_collapser::explore(GraphId node_id) {
     return;
   }
 
-  path forward(node_id), reverse(node_id);
+  // the forward path runs against the second walk and then along the first,
+  // the reverse path against the first walk and then along the second. the
+  // edges against a walk are found in the opposite order to the path, so are
+  // reversed in place before the rest of the path is appended.
+  m_forward.clear();
+  m_reverse.clear();
+  m_scratch.clear();
+  auto end = explore(node_id, nodes.first, m_scratch, m_reverse);
+  std::reverse(m_reverse.begin(), m_reverse.end());
+
+  // the first walk came back round to the node, so the path is circular and
+  // both directions are done. each starts at its lowest edge, so a circle
+  // gives the same paths whichever of its nodes it was explored from.
+  if (end == node_id) {
+    m_forward.swap(m_scratch);
+    auto forward_start = rotate_to_lowest_edge(m_reader, m_forward);
+    auto reverse_start = rotate_to_lowest_edge(m_reader, m_reverse);
+    m_func(path_view(forward_start, forward_start, edge_span(m_forward.data(), m_forward.data() + m_forward.size())));
+    m_func(path_view(reverse_start, reverse_start, edge_span(m_reverse.data(), m_reverse.data() + m_reverse.size())));
+    return;
+  }
 
-  explore(node_id, nodes.first,  forward, reverse);
-  explore(node_id, nodes.second, reverse, forward);
+  auto start = explore(node_id, nodes.second, m_reverse, m_forward);
+  std::reverse(m_forward.begin(), m_forward.end());
+  m_forward.insert(m_forward.end(), m_scratch.begin(), m_scratch.end());
 
-  m_func(forward);
-  m_func(reverse);
+  m_func(path_view(start, end, edge_span(m_forward.data(), m_forward.data() + m_forward.size())));
+  m_func(path_view(end, start, edge_span(m_reverse.data(), m_reverse.data() + m_reverse.size())));
 }
 
 // walk in a single direction, using the "direction" given by two nodes to
-// select which edge is considered to be "forward".
-void edge_collapser::explore(GraphId prev, GraphId cur, path &forward, path &reverse) {
+// select which edge is considered to be "forward". the edges along the walk
+// are appended to @along and those back towards the start to @against, both
+// in the order they are found. returns the node at the end of the last edge
+// along the walk, which is the original node if the walk went round a circle.
+GraphId edge_collapser::explore(GraphId prev, GraphId cur, std::vector<GraphId> &along, std::vector<GraphId> &against) {
   const auto original_node_id = prev;
 
-  GraphId maybe_next;
+  GraphId maybe_next, last;
   do {
     auto e1 = edge_between(prev, cur);
-    forward.push_back(segment(prev, e1, cur));
+    along.push_back(e1);
+    last = cur;
     m_tracker.set(e1);
     auto e2 = edge_between(cur, prev);
-    reverse.push_front(segment(cur, e2, prev));
+    against.push_back(e2);
     m_tracker.set(e2);
 
     maybe_next = next_node_id(prev, cur);
-    if (maybe_next) {
-      prev = cur;
-      cur = maybe_next;
-      if (cur == original_node_id) {
-        // circular!
-        break;
-      }
-    }
-  } while (maybe_next);
+    prev = cur;
+    cur = maybe_next;
+    // circular! the edge back to the original node closes the circle.
+  } while (maybe_next && last != original_node_id);
+  return last;
 }
 
-// utility function to make a path out of a single edge. this is called once all
-// the collapsible paths have been found and single edges are all that's left.
-path make_single_edge_path(GraphReader &reader, GraphId edge_id) {
+// utility function to find the nodes at either end of a single edge. this is
+// called once all the collapsible paths have been found and single edges are
+// all that's left.
+segment single_edge_segment(GraphReader &reader, GraphId edge_id) {
   auto *edge = reader.GetGraphTile(edge_id)->directededge(edge_id);
   auto node_id = edge->endnode();
-  auto opp_edge_idx = edge->opp_index();
-  auto edge_idx = reader.GetGraphTile(node_id)->node(node_id)->edge_index() + opp_edge_idx;
-  GraphId opp_edge_id(node_id.tileid(), node_id.level(), edge_idx);
-  auto *opp_edge = reader.GetGraphTile(opp_edge_id)->directededge(opp_edge_id);
+  const auto opp_edges = reader.GetGraphTile(node_id)->edges(node_id);
+  if (edge->opp_index() >= opp_edges.size()) {
+    throw std::runtime_error("Invalid opposing edge index");
+  }
+  auto *opp_edge = (*(opp_edges.begin() + edge->opp_index())).second;
   auto start_node_id = opp_edge->endnode();
 
-  path p(segment(start_node_id, edge_id, node_id));
+  return segment(start_node_id, edge_id, node_id);
+}
+
+// utility function to make a path out of a single edge.
+path make_single_edge_path(GraphReader &reader, GraphId edge_id) {
+  path p(single_edge_segment(reader, edge_id));
   return p;
 }
 
+// returns the tiles of the collapsible nodes along the paths through @nodes,
+// and of the nodes the paths end at, sorted and without duplicates. a
+// collapsible node is on exactly one path, so the nodes reached along a path
+// are skipped and each path is walked once however many of its nodes are
+// given.
+std::vector<GraphId> chain_tiles(GraphReader &reader,
+                                 const std::function<bool(const DirectedEdge *)> &edge_pred,
+                                 const std::vector<GraphId> &nodes) {
+  std::vector<GraphId> tiles;
+  std::unordered_set<GraphId> reached;
+  for (GraphId node_id : nodes) {
+    if (reached.count(node_id) != 0) {
+      continue;
+    }
+    auto neighbours = collapsible_neighbours(reader, edge_pred, node_id);
+    if (!neighbours.first || !neighbours.second) {
+      continue;
+    }
+    reached.insert(node_id);
+    tiles.push_back(node_id.Tile_Base());
+    for (auto cur : {neighbours.first, neighbours.second}) {
+      auto prev = node_id;
+      while (cur != node_id) {
+        tiles.push_back(cur.Tile_Base());
+        auto next = next_in_chain(reader, edge_pred, prev, cur);
+        if (!next) {
+          break;
+        }
+        reached.insert(cur);
+        prev = cur;
+        cur = next;
+      }
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+  tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+  return tiles;
+}
+
+// merges the paths which have an edge in @tiles. the paths are explored from
+// every node in the tiles and every node at the end of one of their edges,
+// which covers all paths with an edge in the tiles. the edge tracker also
+// covers the tiles the paths lead into, so that each one is explored once.
+path_map_t merge_region(const std::vector<GraphId> &tiles, GraphReader &reader,
+                        std::function<bool(const DirectedEdge *)> edge_pred) {
+  std::unordered_set<GraphId> in_region(tiles.begin(), tiles.end());
+  std::vector<GraphId> nodes;
+  for (GraphId tile_id : tiles) {
+    const auto *tile = reader.GetGraphTile(tile_id);
+    uint32_t node_count = tile->header()->nodecount();
+    for (uint32_t i = 0; i < node_count; ++i) {
+      nodes.emplace_back(tile_id.tileid(), tile_id.level(), i);
+    }
+  }
+  for (GraphId tile_id : tiles) {
+    const auto *tile = reader.GetGraphTile(tile_id);
+    const auto num_edges = tile->header()->directededgecount();
+    for (uint32_t i = 0; i < num_edges; ++i) {
+      auto end_node = tile->directededge(i)->endnode();
+      if (in_region.count(end_node.Tile_Base()) == 0) {
+        nodes.push_back(end_node);
+      }
+    }
+  }
+
+  // find the tiles the paths lead into, which go after the region in tile
+  // set order.
+  std::vector<GraphId> tracked(tiles);
+  for (GraphId tile_id : chain_tiles(reader, edge_pred, nodes)) {
+    if (in_region.count(tile_id) == 0) {
+      tracked.push_back(tile_id);
+    }
+  }
+
+  // keep the paths with an edge in the region
+  path_map_t paths;
+  auto keep = [&](const path_view &p) {
+    for (const auto &edge_id : p.m_edges) {
+      if (in_region.count(edge_id.Tile_Base()) != 0) {
+        paths.emplace(p.m_edges[0], path(p));
+        return;
+      }
+    }
+  };
+  edge_tracker tracker = edge_tracker::create(tracked, reader);
+  edge_collapser e(reader, tracker, edge_pred, keep);
+  for (GraphId node_id : nodes) {
+    e.explore(node_id);
+  }
+  emit_single_edges(tiles, reader, tracker, keep);
+  return paths;
+}
+
+namespace {
+
+// runs a job over each tile on a pool of threads, each with its own reader.
+// the paths a job finds for a tile are batched and handed to the user's
+// function on the calling thread in tile order, so the output does not
+// depend on how the threads were scheduled. threads stay at most a window
+// of tiles ahead of the output to bound the memory held by the buffers.
+template <typename Job>
+void run_ordered(const std::vector<GraphId> &tiles, const reader_factory_t &make_reader,
+                 const Job &job, const std::function<void(const path_view &)> &func,
+                 size_t concurrency) {
+  const size_t window = concurrency * 4;
+  std::vector<path_batch> results(tiles.size());
+  std::vector<bool> done(tiles.size(), false);
+  size_t next = 0, consumed = 0;
+  bool failed = false;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  auto work = [&]() {
+    try {
+      auto reader = make_reader();
+      while (true) {
+        size_t i;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return failed || next >= tiles.size() || next < consumed + window; });
+          if (failed || next >= tiles.size()) {
+            return;
+          }
+          i = next++;
+        }
+        path_batch out;
+        job(*reader, tiles[i], out);
+        // clear the cache if it is overcommitted to avoid running out of memory.
+        if (reader->OverCommitted()) {
+          reader->Clear();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        results[i] = std::move(out);
+        done[i] = true;
+        cv.notify_all();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!failed) {
+        failed = true;
+        error = std::current_exception();
+      }
+      cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < concurrency; ++t) {
+    threads.emplace_back(work);
+  }
+
+  // hand the paths of each tile to the user's function, in tile order
+  std::exception_ptr func_error;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    path_batch out;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return failed || done[i]; });
+      if (failed) {
+        break;
+      }
+      out = std::move(results[i]);
+    }
+    try {
+      for (size_t j = 0; j < out.size(); ++j) {
+        func(out[j]);
+      }
+    } catch (...) {
+      func_error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    consumed = i + 1;
+    if (func_error) {
+      failed = true;
+    }
+    cv.notify_all();
+    if (func_error) {
+      break;
+    }
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (func_error) {
+    std::rethrow_exception(func_error);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // anonymous namespace
+
+void parallel_merge(const std::vector<GraphId> &tiles, edge_tracker &tracker,
+                    const reader_factory_t &make_reader,
+                    std::function<bool(const DirectedEdge *)> edge_pred,
+                    std::function<void(const path_view &)> func, size_t concurrency) {
+  if (concurrency == 0) {
+    concurrency = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // explore each path from its first collapsible node. all threads must be
+  // done before looking for unmarked edges.
+  run_ordered(tiles, make_reader,
+    [&](GraphReader &reader, GraphId tile_id, path_batch &out) {
+      edge_collapser e(reader, tracker, edge_pred,
+                       [&out](const path_view &p) { out.push_back(p); });
+      uint32_t node_count = reader.GetGraphTile(tile_id)->header()->nodecount();
+      for (uint32_t i = 0; i < node_count; ++i) {
+        GraphId node_id(tile_id.tileid(), tile_id.level(), i);
+        if (e.first_in_chain(node_id)) {
+          e.explore(node_id);
+        }
+      }
+    }, func, concurrency);
+
+  run_ordered(tiles, make_reader,
+    [&](GraphReader &reader, GraphId tile_id, path_batch &out) {
+      const GraphId tile_ids[] = {tile_id};
+      emit_single_edges(tile_ids, reader, tracker,
+                        [&out](const path_view &p) { out.push_back(p); });
+    }, func, concurrency);
+}
+
 } // namespace detail
 
 segment::segment(GraphId start, GraphId edge, GraphId end)
@@ -281,6 +542,12 @@ path::path(GraphId node_id)
   , m_end(node_id) {
 }
 
+path::path(const path_view &p)
+  : m_start(p.m_start)
+  , m_end(p.m_end)
+  , m_edges(p.m_edges.begin(), p.m_edges.end()) {
+}
+
 void path::push_back(segment s) {
   assert(s.start() == m_end);
   m_end = s.end();
@@ -293,6 +560,31 @@ void path::push_front(segment s) {
   m_edges.push_front(s.edge());
 }
 
+path_view::path_view(GraphId start, GraphId end, edge_span edges)
+  : m_start(start)
+  , m_end(end)
+  , m_edges(edges)
+{}
+
+void path_batch::push_back(const path_view &p) {
+  m_nodes.push_back(p.m_start);
+  m_nodes.push_back(p.m_end);
+  m_edges.insert(m_edges.end(), p.m_edges.begin(), p.m_edges.end());
+  m_offsets.push_back(m_edges.size());
+}
+
+void path_batch::clear() {
+  m_nodes.clear();
+  m_edges.clear();
+  m_offsets.resize(1);
+}
+
+path_view path_batch::operator[](size_t i) const {
+  const GraphId *edges = m_edges.data();
+  return path_view(m_nodes[2 * i], m_nodes[2 * i + 1],
+                   edge_span(edges + m_offsets[i], edges + m_offsets[i + 1]));
+}
+
 }
 }
 }
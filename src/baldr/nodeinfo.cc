@@ -37,7 +37,7 @@ json::MapPtr admin_json(const AdminInfo& admin, uint16_t tz_index) {
 
   //timezone
   const auto& tz_db = DateTime::get_tz_db();
-  auto tz = DateTime::get_tz_db().from_index(tz_index);
+  const auto& tz = tz_db.from_index(tz_index);
   if(tz) {
     //TODO: so much to do but posix tz has pretty much all the info
     m->emplace("time_zone_posix", tz->to_posix_string());
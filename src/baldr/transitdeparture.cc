@@ -165,9 +165,36 @@ uint32_t TransitDeparture::headsign_offset() const {
   return headsign_offset_;
 }
 
-// Get the departure time.
+// Get the departure type.
+uint32_t TransitDeparture::type() const {
+  return type_;
+}
+
+// Get the departure time (start time for frequency based departures).
 uint32_t TransitDeparture::departure_time() const {
-  return departure_times_.fixed_.departure_time_;
+  return (type_ == kFixedSchedule) ?
+        departure_times_.fixed_.departure_time_ :
+        departure_times_.frequency_.start_time_;
+}
+
+// Get the time of the first departure at or after the given time.
+uint32_t TransitDeparture::next_departure_time(const uint32_t current_time) const {
+  if (type_ == kFixedSchedule) {
+    return (departure_times_.fixed_.departure_time_ >= current_time) ?
+        departure_times_.fixed_.departure_time_ : kInvalidDepartureTime;
+  }
+
+  // Round up to the next departure in the series
+  uint32_t start = start_time();
+  if (current_time <= start) {
+    return start;
+  }
+  uint32_t interval = frequency();
+  if (interval == 0) {
+    return kInvalidDepartureTime;
+  }
+  uint32_t next = start + ((current_time - start + interval - 1) / interval) * interval;
+  return (next <= end_time()) ? next : kInvalidDepartureTime;
 }
 
 // Get the elapsed time until arrival at the next stop.
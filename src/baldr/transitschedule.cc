@@ -62,6 +62,23 @@ bool TransitSchedule::IsValid(const uint32_t day, const uint32_t dow,
   }
 }
 
+// Checks many schedule entries at once for the specified day and day of week.
+void TransitSchedule::IsValid(const TransitSchedule* schedules, const size_t count,
+             const uint32_t day, const uint32_t dow, bool date_before_tile,
+             uint8_t* valid) {
+  // Both answers are computed for every entry and one selected, days past
+  // the days mask can only use the day of week
+  const uint32_t shift = day & 63;
+  const uint64_t use_days = (!date_before_tile && day <= kMaxEndDay) ? 1 : 0;
+  for (size_t i = 0; i < count; ++i) {
+    const TransitSchedule& schedule = schedules[i];
+    uint64_t by_day = (schedule.days_ >> shift) & 1;
+    uint64_t by_dow = (schedule.days_of_week_ & dow) != 0;
+    uint64_t days = use_days & (day <= schedule.end_day_);
+    valid[i] = static_cast<uint8_t>((by_day & days) | (by_dow & (days ^ 1)));
+  }
+}
+
 // For sorting so we can make unique list of schedule records per tile
  bool TransitSchedule::operator < (const TransitSchedule& other) const {
    if (days_ == other.days_) {
@@ -0,0 +1,63 @@
+#include "baldr/way_index.h"
+#include "baldr/graphtile.h"
+
+#include <algorithm>
+
+#include <valhalla/midgard/logging.h>
+
+namespace valhalla {
+  namespace baldr {
+    way_index_t::way_index_t(const boost::property_tree::ptree& pt) {
+      GraphReader reader(pt);
+      for (const auto& tile_id : reader.GetTileSet())
+        add(reader, tile_id);
+      finish();
+      LOG_INFO("Way index has " + std::to_string(ways.size()) + " entries");
+    }
+
+    void way_index_t::add(GraphReader& reader, const GraphId& tile_id) {
+      const auto* tile = reader.GetGraphTile(tile_id);
+      if (tile == nullptr)
+        return;
+      const auto base = static_cast<uint32_t>(tile_id.Tile_Base().value);
+      for (auto wayid : tile->GetWayIds())
+        ways.emplace_back(wayid, base);
+      // clear the cache if it is overcommitted to avoid running out of memory.
+      if (reader.OverCommitted())
+        reader.Clear();
+    }
+
+    void way_index_t::finish() {
+      std::sort(ways.begin(), ways.end());
+      ways.erase(std::unique(ways.begin(), ways.end()), ways.end());
+      ways.shrink_to_fit();
+    }
+
+    std::vector<GraphId> way_index_t::tiles(const uint64_t wayid) const {
+      std::vector<GraphId> result;
+      auto range = std::equal_range(ways.cbegin(), ways.cend(), std::make_pair(wayid, uint32_t(0)),
+        [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+          return a.first < b.first;
+        });
+      for (auto itr = range.first; itr != range.second; ++itr)
+        result.emplace_back(static_cast<uint64_t>(itr->second));
+      return result;
+    }
+
+    std::vector<GraphId> way_index_t::edges(const uint64_t wayid, GraphReader& reader) const {
+      std::vector<GraphId> result;
+      for (const auto& tile_id : tiles(wayid)) {
+        const auto* tile = reader.GetGraphTile(tile_id);
+        if (tile == nullptr)
+          continue;
+        auto tile_edges = tile->GetEdgesForWay(wayid);
+        result.insert(result.end(), tile_edges.cbegin(), tile_edges.cend());
+      }
+      return result;
+    }
+
+    size_t way_index_t::size() const {
+      return ways.size();
+    }
+  }
+}
@@ -0,0 +1,108 @@
+#include "test.h"
+#include <vector>
+#include <algorithm>
+#include "config.h"
+#include "baldr/bucket_queue.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct label_cost_t {
+  const std::vector<float>* costs;
+  float operator()(const uint32_t label) const {
+    return (*costs)[label];
+  }
+};
+
+using queue_t = BucketQueue<uint32_t, label_cost_t>;
+
+void TryAddRemove(queue_t& adjlist, std::vector<float>& edgelabels,
+                  const std::vector<float>& costs) {
+  edgelabels = costs;
+  for (uint32_t i = 0; i < costs.size(); i++) {
+    adjlist.add(i, costs[i]);
+  }
+  std::vector<float> expectedorder = costs;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (auto expected : expectedorder) {
+    uint32_t labelindex = adjlist.pop();
+    if (labelindex == queue_t::invalid() || edgelabels[labelindex] != expected) {
+      throw runtime_error("TryAddRemove: expected order test failed");
+    }
+  }
+  if (adjlist.pop() != queue_t::invalid()) {
+    throw runtime_error("TryAddRemove: expected an empty queue");
+  }
+}
+
+void TestAddRemove() {
+  std::vector<float> edgelabels;
+  queue_t adjlist(0, 10000, 1, label_cost_t{&edgelabels});
+  TryAddRemove(adjlist, edgelabels, { 67, 325, 25, 466, 1000, 100005, 758,
+            167, 258, 16442, 278, 111111000 });
+
+  // Reuse the queue after clearing it, the cost range starts over
+  adjlist.clear();
+  TryAddRemove(adjlist, edgelabels, { 5, 30000, 8, 3, 9999 });
+}
+
+void TestClear() {
+  std::vector<float> edgelabels = { 67, 325, 25, 466, 1000, 100005, 758, 167,
+            258, 16442, 278, 111111000 };
+  queue_t adjlist(0, 10000, 50, label_cost_t{&edgelabels});
+  for (uint32_t i = 0; i < edgelabels.size(); i++) {
+    adjlist.add(i, edgelabels[i]);
+  }
+  adjlist.pop();
+  adjlist.clear();
+  if (adjlist.pop() != queue_t::invalid())
+    throw runtime_error("TestClear: failed to return invalid edge index after Clear");
+}
+
+void TestDecreaseCost() {
+  std::vector<float> edgelabels = { 67, 325, 25, 466, 1000, 100005, 758, 167,
+            258, 16442, 278, 111111000 };
+  queue_t adjlist(0, 10000, 1, label_cost_t{&edgelabels});
+  for (uint32_t i = 0; i < edgelabels.size(); i++) {
+    adjlist.add(i, edgelabels[i]);
+  }
+
+  // Decrease within the overflow bucket, from the overflow bucket into the
+  // low level buckets, within a bucket and across low level buckets
+  std::vector<std::pair<uint32_t, float>> decreases = { {11, 20000},
+            {5, 300}, {4, 1000.5f}, {6, 10}, {11, 15} };
+  for (const auto& d : decreases) {
+    float previous = edgelabels[d.first];
+    edgelabels[d.first] = d.second;
+    adjlist.decrease(d.first, d.second, previous);
+  }
+
+  // Every label comes out once in order of its decreased cost
+  std::vector<float> expectedorder = edgelabels;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (auto expected : expectedorder) {
+    uint32_t labelindex = adjlist.pop();
+    if (labelindex == queue_t::invalid() || edgelabels[labelindex] != expected) {
+      throw runtime_error("TestDecreaseCost: expected order test failed");
+    }
+  }
+  if (adjlist.pop() != queue_t::invalid()) {
+    throw runtime_error("TestDecreaseCost: label returned more than once");
+  }
+}
+
+}
+
+int main() {
+  test::suite suite("bucket_queue");
+
+  suite.test(TEST_CASE(TestAddRemove));
+
+  suite.test(TEST_CASE(TestClear));
+
+  suite.test(TEST_CASE(TestDecreaseCost));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,234 @@
+#include "test.h"
+#include "graph_tile_builder.h"
+
+#include "baldr/connectivity_map.h"
+#include "baldr/graphreader.h"
+#include "baldr/nodeinfo.h"
+#include "baldr/directededge.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <fstream>
+#include <sstream>
+
+namespace vb = valhalla::baldr;
+
+namespace {
+
+using test::graph_tile_builder;
+using test::test_graph_reader;
+
+vb::PathLocation location(vb::GraphId edge) {
+  vb::PathLocation location(valhalla::midgard::PointLL(0, 0));
+  location.edges.emplace_back(edge, 0.5f, valhalla::midgard::PointLL(0, 0), 0.0f);
+  return location;
+}
+
+// n0 <-> n1 -> n2, where n2 -> n1 is only open to pedestrians, and an
+// island n3 <-> n4 in the same tile a. n1 <-> n5 crosses into tile b.
+graph_tile_builder build_graph(vb::GraphId a, vb::GraphId b) {
+  graph_tile_builder builder;
+  builder.append_node(0.0f, 0.0f, 1, 0);
+  builder.append_node(0.1f, 0.0f, 3, 1);
+  builder.append_node(0.2f, 0.0f, 1, 4);
+  builder.append_node(0.5f, 0.5f, 1, 5);
+  builder.append_node(0.6f, 0.5f, 1, 6);
+  builder.append_edge(a + uint64_t(1));
+  builder.append_edge(a + uint64_t(0));
+  builder.append_edge(a + uint64_t(2));
+  builder.append_edge(b + uint64_t(0));
+  builder.append_edge(a + uint64_t(1)).set_forwardaccess(vb::kPedestrianAccess);
+  builder.append_edge(a + uint64_t(4));
+  builder.append_edge(a + uint64_t(3));
+  builder.commit_tile(a);
+  builder.append_node(5.0f, 0.0f, 1, 0);
+  builder.append_edge(a + uint64_t(1));
+  builder.commit_tile(b);
+  return builder;
+}
+
+void TestComponents() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  auto builder = build_graph(a, b);
+
+  test_graph_reader reader(std::move(builder.tiles));
+  std::vector<vb::GraphId> tiles = {a, b};
+
+  vb::component_map_t autos(reader, tiles, vb::kAutoAccess);
+  const auto none = vb::component_map_t::kNoComponent;
+  auto main = autos.get_component(a);
+  if (autos.component_count() != 3 || main == none)
+    throw std::runtime_error("Expected 3 components for autos");
+  if (autos.get_component(a + uint64_t(1)) != main || autos.get_component(a + uint64_t(3)) != main ||
+      autos.get_component(b) != main)
+    throw std::runtime_error("Edges of n0, n1 and n5 should share a component");
+  if (autos.get_component(a + uint64_t(2)) != none || autos.get_component(a + uint64_t(4)) != none)
+    throw std::runtime_error("Edges to and from n2 shouldn't have a component");
+  auto island = autos.get_component(a + uint64_t(5));
+  if (island == none || island == main || autos.get_component(a + uint64_t(6)) != island)
+    throw std::runtime_error("Island should have its own component");
+
+  if (!autos.mutually_reachable(location(a), location(b)))
+    throw std::runtime_error("Locations across tiles should be reachable");
+  if (autos.mutually_reachable(location(a), location(a + uint64_t(5))))
+    throw std::runtime_error("Island in the same tile shouldn't be reachable");
+  if (autos.mutually_reachable(location(a), location(a + uint64_t(2))))
+    throw std::runtime_error("One way edge shouldn't be reachable by autos");
+  if (autos.mutually_reachable(location(a + uint64_t(2)), location(a + uint64_t(2))))
+    throw std::runtime_error("Locations on a one way dead end shouldn't be reachable");
+  if (!autos.mutually_reachable(location(a + uint64_t(1)), location(a + uint64_t(1))))
+    throw std::runtime_error("Locations on the same two way edge should be reachable");
+  if (!autos.mutually_reachable(location(a), location(a + uint64_t(1))))
+    throw std::runtime_error("Locations on opposite directions of an edge should be reachable");
+
+  vb::component_map_t pedestrians(reader, tiles, vb::kPedestrianAccess);
+  if (pedestrians.component_count() != 2)
+    throw std::runtime_error("Expected 2 components for pedestrians");
+  if (!pedestrians.mutually_reachable(location(a), location(a + uint64_t(2))))
+    throw std::runtime_error("One way edge should be reachable by pedestrians");
+  if (pedestrians.mutually_reachable(location(a + uint64_t(4)), location(a + uint64_t(6))))
+    throw std::runtime_error("Island shouldn't be reachable by pedestrians");
+}
+
+void TestModeComponents() {
+  // tile ids are parsed from the whole path so it can't have digits
+  auto tile_dir = (boost::filesystem::temp_directory_path() / "connectivity_modes_test").string();
+  boost::filesystem::remove_all(tile_dir);
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+
+  vb::TileHierarchy hier(tile_dir);
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  auto builder = build_graph(a, b);
+  for (const auto& tile : builder.memory) {
+    boost::filesystem::path file(tile_dir + "/" + vb::GraphTile::FileSuffix(tile.first, hier));
+    boost::filesystem::create_directories(file.parent_path());
+    std::ofstream(file.string(), std::ios::binary).write(tile.second.data(), tile.second.size());
+  }
+
+  // both modes are computed from the same tiles on their own threads
+  vb::connectivity_map_t map(pt, {vb::kAutoAccess, vb::kPedestrianAccess});
+  const auto none = vb::component_map_t::kNoComponent;
+  auto main = map.get_component(a, vb::kAutoAccess);
+  if (main == none || map.get_component(b, vb::kAutoAccess) != main ||
+      map.get_component(a + uint64_t(2), vb::kAutoAccess) != none ||
+      map.get_component(a + uint64_t(2), vb::kPedestrianAccess) == none)
+    throw std::runtime_error("Wrong components per mode");
+  if (map.get_component(a, vb::kBicycleAccess) != none)
+    throw std::runtime_error("Mode without components should have no component");
+
+  if (!map.mutually_reachable(location(a), location(b), vb::kAutoAccess))
+    throw std::runtime_error("Locations across tiles should be reachable");
+  if (map.mutually_reachable(location(a), location(a + uint64_t(5)), vb::kAutoAccess) ||
+      map.mutually_reachable(location(a), location(a + uint64_t(2)), vb::kAutoAccess))
+    throw std::runtime_error("Island and one way edge shouldn't be reachable by autos");
+  if (!map.mutually_reachable(location(a), location(a + uint64_t(2)), vb::kPedestrianAccess))
+    throw std::runtime_error("One way edge should be reachable by pedestrians");
+
+  // without components only the tile colors are known, the island shares a tile
+  if (!map.mutually_reachable(location(a), location(a + uint64_t(5)), vb::kBicycleAccess))
+    throw std::runtime_error("Tile colors should say the island is reachable");
+
+  boost::filesystem::remove_all(tile_dir);
+}
+
+// makes an empty file for each tile, which is enough for the tile set
+void touch_tiles(const std::string& tile_dir, const std::vector<vb::GraphId>& ids) {
+  vb::TileHierarchy hier(tile_dir);
+  for (const auto& id : ids) {
+    boost::filesystem::path file(tile_dir + "/" + vb::GraphTile::FileSuffix(id, hier));
+    boost::filesystem::create_directories(file.parent_path());
+    std::ofstream(file.string()).put(0);
+  }
+}
+
+void TestColors() {
+  // tile ids are parsed from the whole path so it can't have digits
+  auto tile_dir = (boost::filesystem::temp_directory_path() / "connectivity_map_test").string();
+  boost::filesystem::remove_all(tile_dir);
+  auto cache = tile_dir + "/connectivity.bin";
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("connectivity_cache", cache);
+
+  // two tiles a tile apart, they aren't connected
+  vb::TileHierarchy hier(tile_dir);
+  auto a = hier.GetGraphId(valhalla::midgard::PointLL(0.1f, 0.1f), 2);
+  auto b = hier.GetGraphId(valhalla::midgard::PointLL(0.6f, 0.1f), 2);
+  touch_tiles(tile_dir, {a, b});
+
+  vb::connectivity_map_t map(pt);
+  if (!boost::filesystem::exists(cache))
+    throw std::runtime_error("Colors should have been cached");
+  if (map.get_color(a) == 0 || map.get_color(b) == 0 || map.get_color(a) == map.get_color(b))
+    throw std::runtime_error("Tiles should have different colors");
+
+  // the circle reaches the other tile with a large enough radius
+  vb::PathLocation location(valhalla::midgard::PointLL(0.24f, 0.1f));
+  location.edges.emplace_back(a, 0.5f, valhalla::midgard::PointLL(0.24f, 0.1f), 0.0f);
+  if (map.get_colors(2, location, 0).size() != 1 || map.get_colors(2, location, 20000).size() != 1)
+    throw std::runtime_error("Circle should only reach its own tile");
+  auto colors = map.get_colors(2, location, 30000);
+  if (colors.size() != 2 || !colors.count(map.get_color(a)) || !colors.count(map.get_color(b)))
+    throw std::runtime_error("Circle should reach both tiles");
+
+  // the cache is used while the tiles are the same, change a color to tell
+  {
+    std::fstream file(cache, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(24 + 8);
+    uint32_t color = 42;
+    file.write(reinterpret_cast<const char*>(&color), sizeof(color));
+  }
+  vb::connectivity_map_t cached(pt);
+  if (cached.get_color(a) != 42 && cached.get_color(b) != 42)
+    throw std::runtime_error("Colors should have come from the cache");
+
+  // once the tiles change they are computed again, filling the gap connects them
+  auto c = hier.GetGraphId(valhalla::midgard::PointLL(0.35f, 0.1f), 2);
+  touch_tiles(tile_dir, {c});
+  vb::connectivity_map_t changed(pt);
+  if (changed.get_color(a) == 42 || changed.get_color(b) == 42 ||
+      changed.get_color(a) != changed.get_color(b) || changed.get_color(c) != changed.get_color(a))
+    throw std::runtime_error("Colors should have been computed again");
+
+  // the connected tiles are one polygon covering all three of them
+  boost::property_tree::ptree geojson;
+  std::stringstream text(changed.to_geojson(2));
+  boost::property_tree::read_json(text, geojson);
+  const auto& features = geojson.get_child("features");
+  if (geojson.get<std::string>("type") != "FeatureCollection" || features.size() != 1)
+    throw std::runtime_error("Expected one feature");
+  const auto& feature = features.front().second;
+  if (feature.get<std::string>("geometry.type") != "Polygon" ||
+      feature.get<uint32_t>("properties.id") != changed.get_color(a) ||
+      feature.get<std::string>("properties.fill-opacity") != "0.8")
+    throw std::runtime_error("Wrong feature");
+  const auto& ring = feature.get_child("geometry.coordinates").front().second;
+  float minx = 180, maxx = -180, miny = 90, maxy = -90;
+  for (const auto& coord : ring) {
+    auto x = coord.second.front().second.get_value<float>();
+    auto y = coord.second.back().second.get_value<float>();
+    minx = std::min(minx, x); maxx = std::max(maxx, x);
+    miny = std::min(miny, y); maxy = std::max(maxy, y);
+  }
+  if (ring.front().second != ring.back().second || minx != 0.f || maxx != 0.75f ||
+      miny != 0.f || maxy != 0.25f)
+    throw std::runtime_error("Wrong polygon");
+
+  boost::filesystem::remove_all(tile_dir);
+}
+
+}
+
+int main() {
+  test::suite suite("connectivity_map");
+
+  suite.test(TEST_CASE(TestComponents));
+  suite.test(TEST_CASE(TestColors));
+  suite.test(TEST_CASE(TestModeComponents));
+
+  return suite.tear_down();
+}
@@ -1,11 +1,20 @@
 #include "test.h"
 
+#include <cstdio>
 #include <string>
 #include <bitset>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/range/algorithm/remove_if.hpp>
 
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
 
+#include "date_time_zonespec.h"
+
 using namespace std;
 using namespace valhalla::baldr;
 
@@ -388,6 +397,125 @@ void TestIsServiceAvailable() {
 
 }
 
+void TestServiceDayMasks() {
+  //against checking every day with boost like get_service_days used to
+  const boost::gregorian::date pivot = DateTime::get_formatted_date(kPivotDate);
+  const uint8_t dows[] = {kSunday, kMonday, kTuesday, kWednesday, kThursday, kFriday, kSaturday};
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<int32_t> dates(-100, 1500);
+  std::uniform_int_distribution<int32_t> lengths(0, 120);
+  std::uniform_int_distribution<uint32_t> masks(0, 127);
+  std::vector<DateTime::service_range_t> services;
+  std::vector<uint32_t> tile_dates;
+  for (int i = 0; i < 2000; ++i) {
+    int32_t start = dates(generator);
+    DateTime::service_range_t service{start, start + lengths(generator), masks(generator)};
+    uint32_t tile_date = std::max(0, start + lengths(generator) - 60);
+    uint64_t expected = 0;
+    for (int32_t day = std::max<int32_t>(service.start_date, tile_date);
+         day <= std::min<int32_t>(service.end_date, tile_date + 59); ++day) {
+      auto date = pivot + boost::gregorian::days(day);
+      if (service.dow_mask & dows[date.day_of_week().as_number()])
+        expected |= uint64_t(1) << (day - tile_date);
+    }
+    if (DateTime::get_service_days(service, tile_date) != expected)
+      throw std::runtime_error("Wrong service days for day " + std::to_string(start));
+    for (int32_t day = service.start_date; day <= service.end_date; ++day) {
+      if (day < 0)
+        continue;
+      bool available = day >= static_cast<int32_t>(tile_date) && day < static_cast<int32_t>(tile_date) + 64 &&
+                       ((expected >> (day - tile_date)) & 1);
+      if (DateTime::is_service_available(expected, tile_date, day, service.end_date) != available)
+        throw std::runtime_error("Wrong service availability for day " + std::to_string(day));
+    }
+    services.push_back(service);
+    tile_dates.push_back(tile_date);
+  }
+
+  //a batch for one tile date is the same as one at a time
+  std::vector<uint64_t> days;
+  DateTime::get_service_days(services, tile_dates.back(), days);
+  if (days.size() != services.size())
+    throw std::runtime_error("Wrong number of service days");
+  for (size_t i = 0; i < services.size(); ++i)
+    if (days[i] != DateTime::get_service_days(services[i], tile_dates.back()))
+      throw std::runtime_error("Wrong batch service days");
+
+  if (DateTime::day_of_week(0) != 3 || DateTime::day_of_week(-1) != 2 ||
+      DateTime::day_of_week(4) != 0)
+    throw std::runtime_error("Wrong day of week");
+}
+
+void TryParseDateTime(const std::string& date_time, bool valid, int32_t year, int32_t month,
+                      int32_t day, int32_t hour, int32_t minute, int32_t second) {
+  DateTime::date_time_fields_t f;
+  bool parsed = DateTime::parse_date_time(date_time, f);
+  if (parsed != valid || (valid && (f.year != year || f.month != month || f.day != day ||
+      f.hour != hour || f.minute != minute || f.second != second)))
+    throw std::runtime_error("Wrong fields parsed from " + date_time);
+}
+
+void TestParseDateTime() {
+  TryParseDateTime("20150516", true, 2015, 5, 16, 0, 0, 0);
+  TryParseDateTime("2015-05-16", true, 2015, 5, 16, 0, 0, 0);
+  TryParseDateTime("2015-05-16T08:05", true, 2015, 5, 16, 8, 5, 0);
+  TryParseDateTime("20150516T08:05:09", true, 2015, 5, 16, 8, 5, 9);
+  TryParseDateTime("26:16:01", true, 0, 0, 0, 26, 16, 1);
+  TryParseDateTime("1:02", true, 0, 0, 0, 1, 2, 0);
+  TryParseDateTime("2015-0516", false, 0, 0, 0, 0, 0, 0);
+  TryParseDateTime("2015-05-16T", false, 0, 0, 0, 0, 0, 0);
+  TryParseDateTime("2015-05-16T08:5", false, 0, 0, 0, 0, 0, 0);
+  TryParseDateTime("2015-05-16 08:05", false, 0, 0, 0, 0, 0, 0);
+  TryParseDateTime("123456:00", false, 0, 0, 0, 0, 0, 0);
+  TryParseDateTime("", false, 0, 0, 0, 0, 0, 0);
+
+  //the helpers give what boost parsing them did
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<int> years(1990, 2030), months(0, 13), days(0, 32),
+      hours(0, 30), minutes(0, 61), forms(0, 3);
+  for (int i = 0; i < 5000; ++i) {
+    char date[16], time[16];
+    snprintf(date, sizeof(date), forms(generator) ? "%04d-%02d-%02d" : "%04d%02d%02d",
+             years(generator), months(generator), days(generator));
+    snprintf(time, sizeof(time), forms(generator) ? "%02d:%02d" : "%02d:%02d:%02d",
+             hours(generator), minutes(generator), minutes(generator));
+    std::string date_time = std::string(date) + "T" + time;
+
+    //dates boost would throw on are still thrown on
+    boost::gregorian::date expected;
+    try {
+      std::string dt = date;
+      dt.erase(boost::remove_if(dt, boost::is_any_of("-")), dt.end());
+      expected = boost::gregorian::from_undelimited_string(dt);
+    } catch (...) {}
+    for (const auto& input : {std::string(date), date_time}) {
+      boost::gregorian::date d;
+      try { d = DateTime::get_formatted_date(input); } catch (...) {}
+      if (d != expected)
+        throw std::runtime_error("Wrong date for " + input);
+    }
+
+    auto td = boost::posix_time::duration_from_string(time);
+    if (DateTime::seconds_from_midnight(time) != td.total_seconds() ||
+        DateTime::seconds_from_midnight(date_time) != td.total_seconds())
+      throw std::runtime_error("Wrong seconds from midnight for " + date_time);
+
+    bool iso = false;
+    if (date_time.size() == 16 && date_time[4] == '-') {
+      try {
+        std::stringstream ss;
+        auto* input_facet = new boost::local_time::local_time_input_facet("%Y-%m-%dT%H:%M");
+        ss.imbue(std::locale(ss.getloc(), input_facet));
+        boost::posix_time::ptime pt;
+        ss.str(date_time);
+        iso = static_cast<bool>(ss >> pt) && std::stoi(time) <= 23 && std::stoi(time + 3) <= 59;
+      } catch (...) {}
+    }
+    if (DateTime::is_iso_local(date_time) != iso)
+      throw std::runtime_error("Wrong iso local for " + date_time);
+  }
+}
+
 void TestIsValid(){
   TryTestIsValid("2015-05-06T01:00",true);
   TryTestIsValid("2015/05-06T01:00",false);
@@ -467,9 +595,174 @@ void TestDST(){
 
 }
 
+void TestTimezoneIndex() {
+  const auto& tz_db = DateTime::get_tz_db();
+  auto regions = tz_db.region_list();
+  for (size_t i = 0; i < regions.size(); ++i) {
+    if (tz_db.to_index(regions[i]) != i + 1)
+      throw std::runtime_error("Wrong timezone index for " + regions[i]);
+    if (tz_db.from_index(i + 1).get() != tz_db.time_zone_from_region(regions[i]).get())
+      throw std::runtime_error("Wrong timezone for " + regions[i]);
+  }
+  if (tz_db.to_index("Not/A_Region") != 0 || tz_db.from_index(0) ||
+      tz_db.from_index(regions.size() + 1))
+    throw std::runtime_error("Unknown timezones should be empty");
+}
+
+void TestLazyUtcOffsets() {
+  //the tables are built on first use, threads racing to build them all get
+  //the same one. this runs first so that none are built yet
+  const auto& tz_db = DateTime::get_tz_db();
+  std::vector<std::vector<const DateTime::tz_offsets_t*> > seen(4);
+  std::vector<std::thread> threads;
+  for (auto& tables : seen) {
+    threads.emplace_back([&tz_db, &tables]() {
+      for (size_t index = tz_db.region_list().size(); index > 0; --index)
+        tables.push_back(&tz_db.offsets_from_index(index));
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (const auto& tables : seen) {
+    if (tables != seen.front() || tables.front()->entries.empty())
+      throw std::runtime_error("Threads got different utc offsets");
+  }
+}
+
+void TestUtcOffsets() {
+  const auto& tz_db = DateTime::get_tz_db();
+  const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<int64_t> seconds(
+      (boost::posix_time::ptime(boost::gregorian::date(1971, 1, 1)) - epoch).total_seconds(),
+      (boost::posix_time::ptime(boost::gregorian::date(2099, 1, 1)) - epoch).total_seconds());
+  for (size_t index = 1; index <= tz_db.region_list().size(); ++index) {
+    const auto& tz = tz_db.from_index(index);
+    const auto& table = tz_db.offsets_from_index(index);
+    if (tz_db.zone_index(tz) != index)
+      throw std::runtime_error("Wrong index for a time zone");
+
+    //random times and the times around each change
+    std::vector<int64_t> times;
+    for (size_t i = 0; i < 200; ++i)
+      times.push_back(seconds(generator));
+    for (const auto& entry : table.entries) {
+      if (!DateTime::tz_offsets_t::covers(entry.utc) || !DateTime::tz_offsets_t::covers(entry.local))
+        continue;
+      for (int64_t delta : {-7200, -3601, -3600, -1800, -1, 0, 1, 1800, 3599, 3600, 7200}) {
+        times.push_back(entry.utc + delta);
+        times.push_back(entry.local + delta);
+      }
+    }
+
+    for (auto utc : times) {
+      //utc to local
+      boost::local_time::local_date_time ldt(epoch + boost::posix_time::seconds(utc), tz);
+      int64_t local = (ldt.local_time() - epoch).total_seconds();
+      if (table.to_local(utc) != local || table.at_utc(utc).dst != ldt.is_dst())
+        throw std::runtime_error("Wrong local time in " + tz_db.region_list()[index - 1]);
+
+      //local to utc resolves skipped and repeated times like get_ldt
+      auto local_time = epoch + boost::posix_time::seconds(utc);
+      auto resolved = DateTime::get_ldt(local_time.date(), local_time.time_of_day(), tz);
+      if (table.to_utc(utc) != (resolved.utc_time() - epoch).total_seconds())
+        throw std::runtime_error("Wrong utc time in " + tz_db.region_list()[index - 1]);
+    }
+  }
+
+  //out of range or no time zone
+  if (tz_db.offsets_from_index(0).to_local(12345) != 12345 ||
+      tz_db.offsets_from_index(100000).to_utc(12345) != 12345 ||
+      DateTime::tz_offsets_t::covers(-86400) || DateTime::tz_offsets_t::covers(5000000000))
+    throw std::runtime_error("Wrong utc offsets out of range");
+
+  //seconds since epoch goes through the table, skipped and repeated times included
+  auto tz = tz_db.from_index(tz_db.to_index("America/New_York"));
+  if (DateTime::seconds_since_epoch("2016-03-13T02:30", tz) != 1457854200 ||
+      DateTime::seconds_since_epoch("2016-11-06T01:30", tz) != 1478413800 ||
+      DateTime::seconds_since_epoch("2016-07-04T12:00", tz) != 1467648000)
+    throw std::runtime_error("Wrong seconds since epoch");
+}
+
+void TestSecondsToDateOffsets() {
+  //zones parsed from the csv aren't in the database, so boost works out their offsets
+  boost::local_time::tz_database csv;
+  std::string tz_data(date_time_zonespec_csv, date_time_zonespec_csv + date_time_zonespec_csv_len);
+  std::stringstream ss(tz_data);
+  csv.load_from_stream(ss);
+
+  const auto& tz_db = DateTime::get_tz_db();
+  const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<int64_t> seconds(
+      (boost::posix_time::ptime(boost::gregorian::date(2000, 1, 1)) - epoch).total_seconds(),
+      (boost::posix_time::ptime(boost::gregorian::date(2040, 1, 1)) - epoch).total_seconds());
+  std::uniform_int_distribution<int64_t> duration(0, 2 * 86400);
+  for (const auto& region : {"America/New_York", "Europe/London", "Australia/Sydney",
+                             "America/Phoenix", "Asia/Kolkata", "America/St_Johns"}) {
+    auto tz = tz_db.from_index(tz_db.to_index(region));
+    auto boost_tz = csv.time_zone_from_region(region);
+    if (!tz || !boost_tz || tz_db.zone_index(boost_tz) != 0)
+      throw std::runtime_error(std::string("Missing time zone ") + region);
+
+    //random trips and trips around each change
+    std::vector<std::pair<int64_t, int64_t> > trips;
+    for (size_t i = 0; i < 200; ++i) {
+      auto origin = seconds(generator);
+      trips.emplace_back(origin, origin + duration(generator));
+    }
+    for (const auto& entry : tz_db.offsets_from_index(tz_db.to_index(region)).entries) {
+      if (!DateTime::tz_offsets_t::covers(entry.utc))
+        continue;
+      for (int64_t delta : {-86400, -7200, -3600, -1, 0, 1, 3600, 7200}) {
+        trips.emplace_back(entry.utc + delta, entry.utc + delta + 3600);
+        trips.emplace_back(entry.utc + delta - 3600, entry.utc + delta);
+      }
+    }
+
+    for (const auto& trip : trips) {
+      for (bool is_depart_at : {true, false}) {
+        std::string origin, dest, expected_origin, expected_dest;
+        DateTime::seconds_to_date(is_depart_at, trip.first, trip.second, tz, tz, origin, dest);
+        DateTime::seconds_to_date(is_depart_at, trip.first, trip.second, boost_tz, boost_tz,
+                                  expected_origin, expected_dest);
+        if (origin != expected_origin || dest != expected_dest)
+          throw std::runtime_error(std::string("Wrong local dates in ") + region + ": " +
+                                   origin + " " + dest + " expected " + expected_origin + " " +
+                                   expected_dest);
+      }
+    }
+  }
+}
+
+void TestZonespecTable() {
+  //the zones loaded from the table must be the ones boost parses from the csv
+  boost::local_time::tz_database csv;
+  std::string tz_data(date_time_zonespec_csv, date_time_zonespec_csv + date_time_zonespec_csv_len);
+  std::stringstream ss(tz_data);
+  csv.load_from_stream(ss);
+
+  const auto& tz_db = DateTime::get_tz_db();
+  if (tz_db.region_list() != csv.region_list())
+    throw std::runtime_error("Wrong time zone regions");
+  for (const auto& region : csv.region_list()) {
+    auto expected = csv.time_zone_from_region(region);
+    auto tz = tz_db.from_index(tz_db.to_index(region));
+    if (tz->to_posix_string() != expected->to_posix_string() ||
+        tz->std_zone_name() != expected->std_zone_name() ||
+        tz->dst_zone_name() != expected->dst_zone_name())
+      throw std::runtime_error("Wrong time zone " + region);
+  }
+
+  auto tz = tz_db.from_index(tz_db.to_index("America/New_York"));
+  if (tz->to_posix_string() != "EST-05EDT+01,M3.2.0/02:00,M11.1.0/02:00")
+    throw std::runtime_error("Wrong America/New_York time zone");
+}
+
 int main(void) {
   test::suite suite("datetime");
 
+  suite.test(TEST_CASE(TestLazyUtcOffsets));
   suite.test(TEST_CASE(TestGetDaysFromPivotDate));
   suite.test(TEST_CASE(TestGetSecondsFromMidnight));
   suite.test(TEST_CASE(TestDOW));
@@ -477,8 +770,14 @@ int main(void) {
   suite.test(TEST_CASE(TestIsoDateTime));
   suite.test(TEST_CASE(TestServiceDays));
   suite.test(TEST_CASE(TestIsServiceAvailable));
+  suite.test(TEST_CASE(TestServiceDayMasks));
   suite.test(TEST_CASE(TestIsValid));
+  suite.test(TEST_CASE(TestParseDateTime));
   suite.test(TEST_CASE(TestDST));
+  suite.test(TEST_CASE(TestTimezoneIndex));
+  suite.test(TEST_CASE(TestUtcOffsets));
+  suite.test(TEST_CASE(TestSecondsToDateOffsets));
+  suite.test(TEST_CASE(TestZonespecTable));
 
   return suite.tear_down();
 }
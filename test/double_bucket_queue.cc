@@ -66,16 +66,89 @@ void TestClear() {
   TryClear(costs);
 }
 
-/**
-void TestDecreseCost() {
-  std::vector<uint32_t> costs = { 67, 325, 25, 466, 1000, 100005, 758, 167,
+void TryDecreaseCost(const bool lazydecrease) {
+  std::vector<float> edgelabels = { 67, 325, 25, 466, 1000, 100005, 758, 167,
             258, 16442, 278, 111111000 };
-  std::vector<uint32_t> expectedorder = costs;
-  std::sort(costs);
-  TryAddRemove(costs, expectedorder);
+  const auto edgecost = [&edgelabels](const uint32_t label) {
+    return edgelabels[label];
+  };
+  DoubleBucketQueue adjlist(0, 10000, 1, edgecost, lazydecrease);
+  for (uint32_t i = 0; i < edgelabels.size(); i++) {
+    adjlist.add(i, edgelabels[i]);
+  }
+
+  // Decrease within the overflow bucket, from the overflow bucket into the
+  // low level buckets, within a bucket and across low level buckets
+  std::vector<std::pair<uint32_t, float>> decreases = { {11, 20000},
+            {5, 300}, {4, 990}, {6, 10}, {11, 15} };
+  for (const auto& d : decreases) {
+    float previous = edgelabels[d.first];
+    edgelabels[d.first] = d.second;
+    adjlist.decrease(d.first, d.second, previous);
+  }
 
+  // Every label comes out once in order of its decreased cost
+  std::vector<float> expectedorder = edgelabels;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (auto expected : expectedorder) {
+    uint32_t labelindex = adjlist.pop();
+    if (labelindex == kInvalidLabel || edgelabels[labelindex] != expected) {
+      throw runtime_error("TryDecreaseCost: expected order test failed");
+    }
+  }
+  if (adjlist.pop() != kInvalidLabel) {
+    throw runtime_error("TryDecreaseCost: label returned more than once");
+  }
+}
+
+void TestDecreaseCost() {
+  TryDecreaseCost(false);
+  TryDecreaseCost(true);
+}
+
+void TestAdaptive() {
+  std::vector<float> edgelabels;
+  for (uint32_t i = 0; i < 100; i++) {
+    edgelabels.push_back((i * 37) % 100 * 50.0f);
+  }
+  const auto edgecost = [&edgelabels](const uint32_t label) {
+    return edgelabels[label];
+  };
+
+  // A range far too small for the costs
+  DoubleBucketQueue adjlist(0, 100, 1, edgecost, true, 4);
+  std::vector<float> expectedorder = edgelabels;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (uint32_t query = 0; query < 2; query++) {
+    for (uint32_t i = 0; i < edgelabels.size(); i++) {
+      adjlist.add(i, edgelabels[i]);
+    }
+    for (auto expected : expectedorder) {
+      uint32_t labelindex = adjlist.pop();
+      if (labelindex == kInvalidLabel || edgelabels[labelindex] != expected) {
+        throw runtime_error("TestAdaptive: expected order test failed");
+      }
+    }
+    if (adjlist.pop() != kInvalidLabel) {
+      throw runtime_error("TestAdaptive: expected an empty queue");
+    }
+
+    // The first query grows the range while popping, the next one fits
+    const auto& stats = adjlist.stats();
+    if (stats.adds != edgelabels.size() || stats.pops != edgelabels.size() ||
+        stats.maxcost != expectedorder.back()) {
+      throw runtime_error("TestAdaptive: wrong stats");
+    }
+    if ((query == 0) != (stats.range_shifts > 0)) {
+      throw runtime_error("TestAdaptive: wrong number of range shifts");
+    }
+    adjlist.clear();
+    adjlist.reset_stats();
+    if (adjlist.range() < expectedorder.back()) {
+      throw runtime_error("TestAdaptive: range should cover the last query");
+    }
+  }
 }
-*/
 
 }
 
@@ -86,7 +159,9 @@ int main() {
 
   suite.test(TEST_CASE(TestClear));
 
-//  suite.test(TEST_CASE(TestDecreaseCost));
+  suite.test(TEST_CASE(TestDecreaseCost));
+
+  suite.test(TEST_CASE(TestAdaptive));
 
   return suite.tear_down();
 }
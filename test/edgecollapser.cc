@@ -1,4 +1,5 @@
 #include "test.h"
+#include "graph_tile_builder.h"
 
 #include "baldr/graphreader.h"
 #include "baldr/nodeinfo.h"
@@ -9,75 +10,8 @@ namespace vb = valhalla::baldr;
 
 namespace {
 
-struct graph_tile_builder {
-  void append_node(float lon, float lat, uint32_t edge_count, uint32_t first_edge) {
-    nodes.push_back(
-      vb::NodeInfo(
-        std::make_pair(lon, lat),
-        vb::RoadClass::kResidential,
-        vb::kAllAccess,
-        vb::NodeType::kStreetIntersection,
-        false));
-    nodes.back().set_edge_count(edge_count);
-    nodes.back().set_edge_index(first_edge);
-  }
-
-  void append_edge(vb::GraphId endnode, uint32_t length) {
-    edges.emplace_back();
-    edges.back().set_endnode(endnode);
-    edges.back().set_length(length);
-    edges.back().set_forwardaccess(vb::kAllAccess);
-    edges.back().set_reverseaccess(vb::kAllAccess);
-    edges.back().set_classification(vb::RoadClass::kResidential);
-  }
-
-  void commit_tile(vb::GraphId id) {
-    const size_t nodes_size = nodes.size() * sizeof(vb::NodeInfo);
-    const size_t edges_size = edges.size() * sizeof(vb::DirectedEdge);
-
-    std::vector<char> mem(sizeof(vb::GraphTileHeader) + nodes_size + edges_size);
-    char *ptr = reinterpret_cast<char *>(mem.data());
-
-    vb::GraphTileHeader *header = new(ptr) vb::GraphTileHeader;
-    header->set_graphid(id);
-    header->set_nodecount(nodes.size());
-    header->set_directededgecount(edges.size());
-
-    ptr += sizeof(vb::GraphTileHeader);
-    memcpy(ptr, nodes.data(), nodes_size);
-    ptr += nodes_size;
-    memcpy(ptr, edges.data(), edges_size);
-
-    auto res = memory.emplace(id, std::move(mem));
-    auto &mem2 = res.first->second;
-    tiles.emplace(id, vb::GraphTile(id, mem2.data(), mem2.size()));
-    nodes.clear();
-    edges.clear();
-  }
-
-  std::vector<vb::NodeInfo> nodes;
-  std::vector<vb::DirectedEdge> edges;
-
-  std::unordered_map<vb::GraphId, std::vector<char> > memory;
-  std::unordered_map<vb::GraphId, vb::GraphTile> tiles;
-};
-
-boost::property_tree::ptree read_json(const std::string &json) {
-  boost::property_tree::ptree p;
-  std::istringstream istr(json);
-  boost::property_tree::json_parser::read_json(istr, p);
-  return p;
-}
-
-const boost::property_tree::ptree fake_config =
-  read_json("{\"tile_dir\": \"/file/does/not/exist\"}");
-
-struct test_graph_reader : public vb::GraphReader {
-  test_graph_reader(std::unordered_map<vb::GraphId, vb::GraphTile> &&tiles)
-    : GraphReader(fake_config) {
-    cache_ = std::move(tiles);
-  }
-};
+using test::graph_tile_builder;
+using test::test_graph_reader;
 
 void TestCollapseEdgeSimple() {
   vb::TileHierarchy hier("");
@@ -255,6 +189,385 @@ void TestCollapseEdgeChain() {
   }
 }
 
+typedef std::vector<std::pair<std::pair<vb::GraphId, vb::GraphId>, std::vector<vb::GraphId> > > path_list;
+
+path_list merge_paths(std::unordered_map<vb::GraphId, vb::GraphTile> tiles,
+                      const std::vector<vb::GraphId> &tile_ids, size_t concurrency) {
+  auto copy = tiles;
+  test_graph_reader reader(std::move(copy));
+  path_list paths;
+  auto pred = [](const vb::DirectedEdge *) -> bool { return true; };
+  auto func = [&](const vb::merge::path &p) {
+    paths.emplace_back(std::make_pair(p.m_start, p.m_end),
+                       std::vector<vb::GraphId>(p.m_edges.begin(), p.m_edges.end()));
+  };
+  if (concurrency == 0) {
+    vb::merge::merge(tile_ids, reader, pred, func);
+  } else {
+    vb::merge::parallel_merge(tile_ids, reader,
+      [&tiles]() -> std::shared_ptr<vb::GraphReader> {
+        auto copy = tiles;
+        return std::make_shared<test_graph_reader>(std::move(copy));
+      }, pred, func, concurrency);
+  }
+  return paths;
+}
+
+void build_two_tiles(graph_tile_builder &builder, vb::GraphId a, vb::GraphId b) {
+  // a chain which crosses between two tiles, collapsible from a1 to b1,
+  // and a junction at b2 which can't be collapsed.
+  //
+  //  (a0)--(a1)--(b0)--(a2)--(b1)--(a3)    (b3)--(b2)--(b4)
+  //                                               |
+  //                                              (b5)
+  builder.append_node(0.0f, 0.0f, 1, 0);
+  builder.append_node(0.1f, 0.0f, 2, 1);
+  builder.append_node(0.3f, 0.0f, 2, 3);
+  builder.append_node(0.5f, 0.0f, 1, 5);
+  builder.append_edge(a + uint64_t(1), 100);
+  builder.append_edge(a + uint64_t(0), 100);
+  builder.append_edge(b + uint64_t(0), 100);
+  builder.append_edge(b + uint64_t(0), 100);
+  builder.append_edge(b + uint64_t(1), 100);
+  builder.append_edge(b + uint64_t(1), 100);
+  builder.commit_tile(a);
+
+  builder.append_node(5.2f, 0.0f, 2, 0);
+  builder.append_node(5.4f, 0.0f, 2, 2);
+  builder.append_node(5.6f, 0.0f, 3, 4);
+  builder.append_node(5.5f, 0.0f, 1, 7);
+  builder.append_node(5.7f, 0.0f, 1, 8);
+  builder.append_node(5.6f, 0.1f, 1, 9);
+  builder.append_edge(a + uint64_t(1), 100);
+  builder.append_edge(a + uint64_t(2), 100);
+  builder.append_edge(a + uint64_t(2), 100);
+  builder.append_edge(a + uint64_t(3), 100);
+  builder.append_edge(b + uint64_t(3), 100);
+  builder.append_edge(b + uint64_t(4), 100);
+  builder.append_edge(b + uint64_t(5), 100);
+  builder.append_edge(b + uint64_t(2), 100);
+  builder.append_edge(b + uint64_t(2), 100);
+  builder.append_edge(b + uint64_t(2), 100);
+  builder.commit_tile(b);
+}
+
+void TestParallelMerge() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  graph_tile_builder builder;
+  build_two_tiles(builder, a, b);
+
+  // the parallel merge finds the same paths, in the same order, whatever
+  // the number of threads and whichever order the tiles are given in
+  for (const auto &tile_ids : { std::vector<vb::GraphId>{a, b}, std::vector<vb::GraphId>{b, a} }) {
+    auto expected = merge_paths(builder.tiles, tile_ids, 0);
+    if (expected.size() != 8 || expected.front().second.size() != 5) {
+      throw std::runtime_error("Expected the chain and 6 single edges");
+    }
+    for (size_t concurrency : {1, 2, 4}) {
+      if (merge_paths(builder.tiles, tile_ids, concurrency) != expected) {
+        throw std::runtime_error("Parallel merge found different paths");
+      }
+    }
+  }
+
+  // merging only one of the tiles walks edges which leave the tile set,
+  // they must be treated as already visited rather than marking some
+  // unrelated edge of the tile which is being merged
+  auto expected = merge_paths(builder.tiles, {a}, 0);
+  if (expected.empty()) {
+    throw std::runtime_error("Expected paths when merging a single tile");
+  }
+  for (size_t concurrency : {1, 2}) {
+    if (merge_paths(builder.tiles, {a}, concurrency) != expected) {
+      throw std::runtime_error("Parallel merge of a single tile found different paths");
+    }
+  }
+}
+
+void TestEdgeTracker() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  vb::GraphId c = hier.GetGraphId(valhalla::midgard::PointLL(10, 0), 0);
+
+  graph_tile_builder builder;
+  builder.append_node(0.0f, 0.0f, 3, 0);
+  builder.append_edge(a, 100);
+  builder.append_edge(a, 100);
+  builder.append_edge(a, 100);
+  builder.commit_tile(a);
+  builder.append_node(5.0f, 0.0f, 2, 0);
+  builder.append_edge(b, 100);
+  builder.append_edge(b, 100);
+  builder.commit_tile(b);
+
+  test_graph_reader reader(std::move(builder.tiles));
+  std::vector<vb::GraphId> tiles = {b, a};
+  auto tracker = vb::merge::detail::edge_tracker::create(tiles, reader);
+
+  // offsets are the edge counts of the earlier tiles in tile set order
+  if (tracker.tile_offset(b) != 0 || tracker.tile_offset(a + uint64_t(2)) != 2) {
+    throw std::runtime_error("Wrong tile offsets");
+  }
+  if (tracker.tile_offset(c) != vb::merge::detail::edge_tracker::no_tile ||
+      tracker.tile_offset(vb::GraphId(a.tileid(), 7, 0)) != vb::merge::detail::edge_tracker::no_tile) {
+    throw std::runtime_error("Tiles outside the tile set should have no offset");
+  }
+  if (!tracker.before(b + uint64_t(1), a) || tracker.before(a, b) || tracker.before(c, a)) {
+    throw std::runtime_error("Wrong tile set order");
+  }
+
+  tracker.set(a + uint64_t(1));
+  tracker.set(b);
+  for (uint64_t i = 0; i < 3; ++i) {
+    if (tracker.get(a + i) != (i == 1)) {
+      throw std::runtime_error("Wrong edges marked in first tile");
+    }
+  }
+  if (!tracker.get(b) || tracker.get(b + uint64_t(1))) {
+    throw std::runtime_error("Wrong edges marked in second tile");
+  }
+
+  // edges leaving the tile set count as visited and marking them changes nothing
+  tracker.set(c + uint64_t(1));
+  tracker.set(vb::GraphId(a.tileid(), 7, 2));
+  if (!tracker.get(c + uint64_t(1)) || !tracker.get(vb::GraphId(a.tileid(), 7, 0))) {
+    throw std::runtime_error("Edges outside the tile set should count as visited");
+  }
+  for (uint64_t i = 0; i < 3; ++i) {
+    if (tracker.get(a + i) != (i == 1) || (i < 2 && tracker.get(b + i) != (i == 0))) {
+      throw std::runtime_error("Edges outside the tile set changed other edges");
+    }
+  }
+}
+
+void TestStreamMerge() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  graph_tile_builder builder;
+  build_two_tiles(builder, a, b);
+  std::vector<vb::GraphId> tile_ids = {a, b};
+  auto pred = [](const vb::DirectedEdge *) -> bool { return true; };
+  auto expected = merge_paths(builder.tiles, tile_ids, 0);
+
+  // views hold the same paths as merge, in the same order
+  path_list paths;
+  {
+    auto copy = builder.tiles;
+    test_graph_reader reader(std::move(copy));
+    vb::merge::stream_merge(tile_ids, reader, pred, [&](const vb::merge::path_view &p) {
+      paths.emplace_back(std::make_pair(p.m_start, p.m_end),
+                         std::vector<vb::GraphId>(p.m_edges.begin(), p.m_edges.end()));
+    });
+  }
+  if (paths != expected) {
+    throw std::runtime_error("Streamed paths differ from merged paths");
+  }
+
+  // batches hold the same paths, at most batch size at a time
+  for (size_t batch_size : {1, 3, 100}) {
+    auto copy = builder.tiles;
+    test_graph_reader reader(std::move(copy));
+    paths.clear();
+    size_t batches = 0;
+    vb::merge::batch_merge(tile_ids, reader, pred, batch_size, [&](const vb::merge::path_batch &batch) {
+      if (batch.empty() || batch.size() > batch_size) {
+        throw std::runtime_error("Wrong batch size");
+      }
+      for (size_t i = 0; i < batch.size(); ++i) {
+        auto p = batch[i];
+        paths.emplace_back(std::make_pair(p.m_start, p.m_end),
+                           std::vector<vb::GraphId>(p.m_edges.begin(), p.m_edges.end()));
+      }
+      batches += 1;
+    });
+    if (paths != expected) {
+      throw std::runtime_error("Batched paths differ from merged paths");
+    }
+    if (batches != (expected.size() + batch_size - 1) / batch_size) {
+      throw std::runtime_error("Wrong number of batches");
+    }
+  }
+}
+
+// the paths of a full merge which have an edge in one of the region's tiles
+std::map<vb::GraphId, vb::merge::path> region_paths(std::unordered_map<vb::GraphId, vb::GraphTile> tiles,
+                                                    const std::vector<vb::GraphId> &tile_ids,
+                                                    const std::set<vb::GraphId> &region) {
+  test_graph_reader reader(std::move(tiles));
+  std::map<vb::GraphId, vb::merge::path> paths;
+  vb::merge::merge(
+    tile_ids, reader,
+    [](const vb::DirectedEdge *) -> bool { return true; },
+    [&](const vb::merge::path &p) {
+      for (auto id : p.m_edges) {
+        if (region.count(id.Tile_Base()) != 0) {
+          paths.emplace(p.m_edges.front(), p);
+          return;
+        }
+      }
+    });
+  return paths;
+}
+
+bool same_paths(const std::map<vb::GraphId, vb::merge::path> &a,
+                const std::map<vb::GraphId, vb::merge::path> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (auto itr = a.begin(), jtr = b.begin(); itr != a.end(); ++itr, ++jtr) {
+    if (itr->first != jtr->first || itr->second.m_start != jtr->second.m_start ||
+        itr->second.m_end != jtr->second.m_end || itr->second.m_edges != jtr->second.m_edges) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TestChainTiles() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  graph_tile_builder builder;
+  build_two_tiles(builder, a, b);
+  test_graph_reader reader(std::move(builder.tiles));
+  auto pred = [](const vb::DirectedEdge *) -> bool { return true; };
+
+  // every node of the chain through a1..b1 is given, and the chain reaches
+  // from tile a into tile b
+  std::vector<vb::GraphId> nodes;
+  for (uint64_t i = 0; i < 4; ++i) {
+    nodes.push_back(a + i);
+  }
+  if (vb::merge::detail::chain_tiles(reader, pred, nodes) != std::vector<vb::GraphId>{a, b}) {
+    throw std::runtime_error("Expected the chain to cross into tile b");
+  }
+
+  // the junction at b2 and the dead ends around it aren't collapsible
+  nodes = {b + uint64_t(2), b + uint64_t(3), b + uint64_t(5)};
+  if (!vb::merge::detail::chain_tiles(reader, pred, nodes).empty()) {
+    throw std::runtime_error("Expected no chains through b2");
+  }
+}
+
+void TestIncrementalMerge() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+  graph_tile_builder old_graph;
+  build_two_tiles(old_graph, a, b);
+
+  // the same graph with the spur to b5 removed, so b2 is no longer a
+  // junction and (b3)--(b2)--(b4) collapses.
+  graph_tile_builder new_graph;
+  build_two_tiles(new_graph, a, b);
+  new_graph.tiles.erase(b);
+  new_graph.memory.erase(b);
+  new_graph.append_node(5.2f, 0.0f, 2, 0);
+  new_graph.append_node(5.4f, 0.0f, 2, 2);
+  new_graph.append_node(5.6f, 0.0f, 2, 4);
+  new_graph.append_node(5.5f, 0.0f, 1, 6);
+  new_graph.append_node(5.7f, 0.0f, 1, 7);
+  new_graph.append_edge(a + uint64_t(1), 100);
+  new_graph.append_edge(a + uint64_t(2), 100);
+  new_graph.append_edge(a + uint64_t(2), 100);
+  new_graph.append_edge(a + uint64_t(3), 100);
+  new_graph.append_edge(b + uint64_t(3), 100);
+  new_graph.append_edge(b + uint64_t(4), 100);
+  new_graph.append_edge(b + uint64_t(2), 100);
+  new_graph.append_edge(b + uint64_t(2), 100);
+  new_graph.commit_tile(b);
+
+  std::vector<vb::GraphId> all = {a, b};
+  for (const auto &region : { std::set<vb::GraphId>{b}, std::set<vb::GraphId>{a, b} }) {
+    // the delta is the difference between full merges, restricted to the
+    // paths with an edge in the region
+    auto before = region_paths(old_graph.tiles, all, region);
+    auto after = region_paths(new_graph.tiles, all, region);
+    std::map<vb::GraphId, vb::merge::path> removed, added;
+    for (const auto &p : before) {
+      auto itr = after.find(p.first);
+      if (itr == after.end() || !same_paths({*itr}, {p})) {
+        removed.emplace(p);
+      }
+    }
+    for (const auto &p : after) {
+      auto itr = before.find(p.first);
+      if (itr == before.end() || !same_paths({*itr}, {p})) {
+        added.emplace(p);
+      }
+    }
+
+    auto old_tiles = old_graph.tiles;
+    auto new_tiles = new_graph.tiles;
+    test_graph_reader old_reader(std::move(old_tiles));
+    test_graph_reader new_reader(std::move(new_tiles));
+    auto delta = vb::merge::incremental_merge(
+      region, old_reader, new_reader,
+      [](const vb::DirectedEdge *) -> bool { return true; });
+
+    // the chain through a1..b1 is unchanged, the 6 single edges around b2
+    // are replaced by a chain in each direction
+    if (delta.removed.size() != 6 || delta.added.size() != 2) {
+      throw std::runtime_error("Expected 6 removed and 2 added paths");
+    }
+    if (!same_paths(delta.removed, removed) || !same_paths(delta.added, added)) {
+      throw std::runtime_error("Incremental merge differs from full merge");
+    }
+  }
+}
+
+void TestCircularMerge() {
+  vb::TileHierarchy hier("");
+  vb::GraphId a = hier.GetGraphId(valhalla::midgard::PointLL(0, 0), 0);
+  vb::GraphId b = hier.GetGraphId(valhalla::midgard::PointLL(5, 0), 0);
+
+  // a circle which crosses between two tiles, with nothing but collapsible
+  // nodes on it.
+  //
+  //  (a0)--(a1)--(b0)--(b1)--(a0)
+  graph_tile_builder builder;
+  builder.append_node(0.0f, 0.0f, 2, 0);
+  builder.append_node(0.1f, 0.0f, 2, 2);
+  builder.append_edge(a + uint64_t(1), 100);
+  builder.append_edge(b + uint64_t(1), 100);
+  builder.append_edge(a + uint64_t(0), 100);
+  builder.append_edge(b + uint64_t(0), 100);
+  builder.commit_tile(a);
+  builder.append_node(5.1f, 0.0f, 2, 0);
+  builder.append_node(5.0f, 0.0f, 2, 2);
+  builder.append_edge(b + uint64_t(1), 100);
+  builder.append_edge(a + uint64_t(1), 100);
+  builder.append_edge(b + uint64_t(0), 100);
+  builder.append_edge(a + uint64_t(0), 100);
+  builder.commit_tile(b);
+
+  // each direction round the circle starts at its lowest edge
+  std::vector<vb::GraphId> all = {a, b};
+  auto full = region_paths(builder.tiles, all, {a, b});
+  if (full.size() != 2) {
+    throw std::runtime_error("Expected a path each way round the circle");
+  }
+  for (const auto &p : full) {
+    if (p.second.m_edges.size() != 4 || p.second.m_start != p.second.m_end ||
+        p.first != *std::min_element(p.second.m_edges.begin(), p.second.m_edges.end())) {
+      throw std::runtime_error("Expected the circle to start at its lowest edge");
+    }
+  }
+
+  // reaching the circle from tile b first gives the same paths
+  auto tiles = builder.tiles;
+  test_graph_reader reader(std::move(tiles));
+  auto region = vb::merge::detail::merge_region(
+    {b}, reader, [](const vb::DirectedEdge *) -> bool { return true; });
+  if (!same_paths(region, full)) {
+    throw std::runtime_error("Circle was keyed by where it was reached from");
+  }
+}
+
 } // anonymous namespace
 
 int main() {
@@ -263,6 +576,12 @@ int main() {
   suite.test(TEST_CASE(TestCollapseEdgeSimple));
   suite.test(TEST_CASE(TestCollapseEdgeJunction));
   suite.test(TEST_CASE(TestCollapseEdgeChain));
+  suite.test(TEST_CASE(TestParallelMerge));
+  suite.test(TEST_CASE(TestEdgeTracker));
+  suite.test(TEST_CASE(TestStreamMerge));
+  suite.test(TEST_CASE(TestChainTiles));
+  suite.test(TEST_CASE(TestIncrementalMerge));
+  suite.test(TEST_CASE(TestCircularMerge));
 
   return suite.tear_down();
 }
@@ -0,0 +1,115 @@
+#include "test.h"
+
+#include "baldr/edgeinfo.h"
+#include <valhalla/midgard/encoded.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// lay out an edge info record in memory: way id, packed item, no names and
+// then the encoded shape
+std::vector<char> make_edgeinfo(const std::string& encoded, uint64_t wayid) {
+  std::vector<char> mem(sizeof(uint64_t) + sizeof(EdgeInfo::PackedItem) + encoded.size());
+  std::memcpy(mem.data(), &wayid, sizeof(uint64_t));
+  EdgeInfo::PackedItem item{};
+  item.encoded_shape_size = encoded.size();
+  std::memcpy(mem.data() + sizeof(uint64_t), &item, sizeof(item));
+  std::memcpy(mem.data() + sizeof(uint64_t) + sizeof(item), encoded.data(), encoded.size());
+  return mem;
+}
+
+void TestDecodeShape7() {
+  std::vector<PointLL> shape = {
+    {-76.299222f, 40.042112f}, {-76.299149f, 40.042381f},
+    {-76.298702f, 40.043011f}, {-76.297999f, 40.043999f},
+    {-76.210000f, 40.110000f}, {-76.209999f, 40.110001f},
+    {179.999999f, -89.999999f}, {-179.999999f, 89.999999f},
+    {0.f, 0.f}
+  };
+  auto encoded = encode7(shape);
+
+  // should match the reference decoder exactly
+  auto expected = decode7<std::vector<PointLL> >(encoded.data(), encoded.size());
+  auto decoded = decode_shape7(encoded.data(), encoded.size());
+  if (decoded != expected)
+    throw std::runtime_error("Decoded shape does not match reference decoder");
+
+  // five byte varints hold all 32 bits, zig-zagged to the extremes of int32
+  const char extremes[] = { '\xfe', '\xff', '\xff', '\xff', '\x0f',
+                            '\xff', '\xff', '\xff', '\xff', '\x0f' };
+  decoded = decode_shape7(extremes, sizeof(extremes));
+  if (decoded.size() != 1 ||
+      std::abs(decoded.front().lat() - 2147.483647) > 1e-3 ||
+      std::abs(decoded.front().lng() + 2147.483648) > 1e-3)
+    throw std::runtime_error("Largest varints decoded incorrectly");
+
+  // and nothing at all is fine too
+  if (!decode_shape7(encoded.data(), 0).empty())
+    throw std::runtime_error("Empty encoded shape should decode to nothing");
+
+  // a truncated shape is not
+  test::assert_throw<std::runtime_error>([&encoded]() {
+    decode_shape7(encoded.data(), encoded.size() - 1);
+  }, "Truncated shape should throw");
+}
+
+void TestShapeCache() {
+  std::vector<PointLL> shape = { {-76.299222f, 40.042112f}, {-76.299149f, 40.042381f} };
+  auto encoded = encode7(shape);
+  auto mem = make_edgeinfo(encoded, 1234);
+
+  ShapeCache cache(2);
+  EdgeInfo a(mem.data(), nullptr, 0, &cache, 0);
+  EdgeInfo b(mem.data(), nullptr, 0, &cache, 0);
+  if (a.wayid() != 1234)
+    throw std::runtime_error("Wrong way id");
+  if (&a.shape() != &b.shape())
+    throw std::runtime_error("Shape should have been shared through the cache");
+  if (cache.size() != 1 || cache.memory() != shape.size() * sizeof(PointLL))
+    throw std::runtime_error("Cache should have one shape");
+
+  // fill it past its limit, shapes already handed out stay valid
+  const auto& held = a.shape();
+  cache.get(10, encoded.data(), encoded.size());
+  if (cache.memory() != 2 * shape.size() * sizeof(PointLL))
+    throw std::runtime_error("Cache should count the memory of both shapes");
+  cache.get(20, encoded.data(), encoded.size());
+  if (cache.size() != 1 || cache.memory() != shape.size() * sizeof(PointLL))
+    throw std::runtime_error("Cache should have been flushed");
+  if (held.size() != shape.size())
+    throw std::runtime_error("Shape should outlive the cache flush");
+
+  // a running total follows the memory as shapes are decoded and flushed
+  auto total = std::make_shared<size_t>(1);
+  cache.report_to(total);
+  if (*total != 1 + shape.size() * sizeof(PointLL))
+    throw std::runtime_error("Total should include the memory already used");
+  cache.get(30, encoded.data(), encoded.size());
+  if (*total != 1 + cache.memory())
+    throw std::runtime_error("Total should follow decoded shapes");
+  cache.clear();
+  if (*total != 1)
+    throw std::runtime_error("Total should follow the flush");
+
+  // without a cache we still decode
+  EdgeInfo c(mem.data(), nullptr, 0);
+  if (c.shape() != a.shape())
+    throw std::runtime_error("Uncached shape does not match");
+}
+
+}
+
+int main() {
+  test::suite suite("edgeinfo");
+
+  suite.test(TEST_CASE(TestDecodeShape7));
+  suite.test(TEST_CASE(TestShapeCache));
+
+  return suite.tear_down();
+}
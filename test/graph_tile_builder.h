@@ -0,0 +1,115 @@
+// -*- mode: c++ -*-
+
+#ifndef TEST_GRAPH_TILE_BUILDER_H
+#define TEST_GRAPH_TILE_BUILDER_H
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/nodeinfo.h"
+#include "baldr/directededge.h"
+#include "baldr/edgeinfo.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace test {
+
+//builds tiles of nodes, edges and edge infos (way id only) in memory
+struct graph_tile_builder {
+  void append_node(float lon, float lat, uint32_t edge_count, uint32_t first_edge) {
+    nodes.push_back(
+      valhalla::baldr::NodeInfo(
+        std::make_pair(lon, lat),
+        valhalla::baldr::RoadClass::kResidential,
+        valhalla::baldr::kAllAccess,
+        valhalla::baldr::NodeType::kStreetIntersection,
+        false));
+    nodes.back().set_edge_count(edge_count);
+    nodes.back().set_edge_index(first_edge);
+  }
+
+  //the edge is only valid until the next one is appended
+  valhalla::baldr::DirectedEdge& append_edge(valhalla::baldr::GraphId endnode,
+                                             uint32_t length = 100, uint64_t wayid = 0) {
+    edges.emplace_back();
+    edges.back().set_endnode(endnode);
+    edges.back().set_length(length);
+    edges.back().set_edgeinfo_offset(edgeinfo.size());
+    edges.back().set_forwardaccess(valhalla::baldr::kAllAccess);
+    edges.back().set_reverseaccess(valhalla::baldr::kAllAccess);
+    edges.back().set_classification(valhalla::baldr::RoadClass::kResidential);
+    valhalla::baldr::EdgeInfo::PackedItem item{};
+    const char* w = reinterpret_cast<const char*>(&wayid);
+    const char* i = reinterpret_cast<const char*>(&item);
+    edgeinfo.insert(edgeinfo.end(), w, w + sizeof(wayid));
+    edgeinfo.insert(edgeinfo.end(), i, i + sizeof(item));
+    return edges.back();
+  }
+
+  void commit_tile(valhalla::baldr::GraphId id) {
+    const size_t nodes_size = nodes.size() * sizeof(valhalla::baldr::NodeInfo);
+    const size_t edges_size = edges.size() * sizeof(valhalla::baldr::DirectedEdge);
+    const size_t header_size = sizeof(valhalla::baldr::GraphTileHeader);
+
+    std::vector<char> mem(header_size + nodes_size + edges_size + edgeinfo.size());
+    char *ptr = mem.data();
+
+    auto *header = new(ptr) valhalla::baldr::GraphTileHeader;
+    header->set_graphid(id);
+    header->set_nodecount(nodes.size());
+    header->set_directededgecount(edges.size());
+    header->set_edgeinfo_offset(header_size + nodes_size + edges_size);
+    header->set_textlist_offset(mem.size());
+    header->set_traffic_segmentid_offset(mem.size());
+    header->set_traffic_chunk_offset(mem.size());
+    header->set_end_offset(mem.size());
+
+    ptr += header_size;
+    memcpy(ptr, nodes.data(), nodes_size);
+    ptr += nodes_size;
+    memcpy(ptr, edges.data(), edges_size);
+    ptr += edges_size;
+    memcpy(ptr, edgeinfo.data(), edgeinfo.size());
+
+    auto res = memory.emplace(id, std::move(mem));
+    auto &mem2 = res.first->second;
+    tiles.emplace(id, valhalla::baldr::GraphTile(id, mem2.data(), mem2.size()));
+    nodes.clear();
+    edges.clear();
+    edgeinfo.clear();
+  }
+
+  std::vector<valhalla::baldr::NodeInfo> nodes;
+  std::vector<valhalla::baldr::DirectedEdge> edges;
+  std::vector<char> edgeinfo;
+
+  std::unordered_map<valhalla::baldr::GraphId, std::vector<char> > memory;
+  std::unordered_map<valhalla::baldr::GraphId, valhalla::baldr::GraphTile> tiles;
+};
+
+inline boost::property_tree::ptree read_json(const std::string &json) {
+  boost::property_tree::ptree p;
+  std::istringstream istr(json);
+  boost::property_tree::json_parser::read_json(istr, p);
+  return p;
+}
+
+const boost::property_tree::ptree fake_config =
+  read_json("{\"tile_dir\": \"/file/does/not/exist\"}");
+
+//a reader whose cache is the tiles of a builder
+struct test_graph_reader : public valhalla::baldr::GraphReader {
+  test_graph_reader(std::unordered_map<valhalla::baldr::GraphId, valhalla::baldr::GraphTile> &&tiles)
+    : GraphReader(fake_config) {
+    cache_ = std::move(tiles);
+  }
+};
+
+}
+
+#endif
@@ -16,6 +16,7 @@ class test_reader : public GraphReader {
   using GraphReader::GraphReader;
   using GraphReader::cache_size_;
   using GraphReader::max_cache_size_;
+  using GraphReader::decoded_shapes_size_;
 };
 
 test_reader make_cache(std::string cache_size) {
@@ -67,6 +68,16 @@ void TestCacheLimits() {
   cache.max_cache_size_ = 0;
   if(!cache.OverCommitted())
     throw std::runtime_error("Cache should be over committed");
+
+  // decoded shapes count towards the limit until the cache is cleared
+  cache.Clear();
+  cache.max_cache_size_ = 1;
+  *cache.decoded_shapes_size_ = 2;
+  if(!cache.OverCommitted())
+    throw std::runtime_error("Cache should be over committed by decoded shapes");
+  cache.Clear();
+  if(cache.OverCommitted() || *cache.decoded_shapes_size_ != 0)
+    throw std::runtime_error("Clear should reset the decoded shapes");
 }
 
 void touch_tile(const uint32_t tile_id, const TileHierarchy& tile_hierarchy) {
@@ -2,6 +2,7 @@
 
 #include "baldr/graphtile.h"
 
+#include <random>
 #include <vector>
 
 using namespace valhalla::baldr;
@@ -14,6 +15,24 @@ struct testable_graphtile : public valhalla::baldr::GraphTile {
     header_->set_edge_bin_offsets(offsets);
     edge_bins_ = bins.data();
   }
+  testable_graphtile(const GraphId& id, std::vector<NodeInfo>& nodes,
+                     std::vector<DirectedEdge>& edges) {
+    header_ = new GraphTileHeader();
+    header_->set_graphid(id);
+    header_->set_nodecount(nodes.size());
+    header_->set_directededgecount(edges.size());
+    nodes_ = nodes.data();
+    directededges_ = edges.data();
+  }
+  testable_graphtile(std::vector<TransitDeparture>& departures,
+                     std::vector<TransitSchedule>& schedules) {
+    header_ = new GraphTileHeader();
+    header_->set_departurecount(departures.size());
+    header_->set_schedulecount(schedules.size());
+    departures_ = departures.data();
+    transit_schedules_ = schedules.data();
+    IndexDepartures();
+  }
 };
 
 void file_suffix() {
@@ -67,6 +86,173 @@ void bin() {
   }
 }
 
+void edges() {
+  // 3 nodes with 2, 0 and 3 edges
+  std::vector<NodeInfo> nodes(3);
+  nodes[0].set_edge_index(0); nodes[0].set_edge_count(2);
+  nodes[1].set_edge_index(2); nodes[1].set_edge_count(0);
+  nodes[2].set_edge_index(2); nodes[2].set_edge_count(3);
+  std::vector<DirectedEdge> des(5);
+  for(size_t i = 0; i < des.size(); ++i)
+    des[i].set_endnode(GraphId(7, 1, i));
+  GraphId tile_id(7, 1, 0);
+  testable_graphtile t(tile_id, nodes, des);
+
+  if(!t.edges(GraphId(7, 1, 1)).empty())
+    throw std::logic_error("Node 1 should have no edges");
+
+  size_t count = 0;
+  for(const auto& edge : t.edges(GraphId(7, 1, 2))) {
+    if(edge.first != GraphId(7, 1, 2 + count) || edge.second != &des[2 + count] ||
+       edge.second->endnode() != edge.first)
+      throw std::logic_error("Wrong edge from node 2");
+    ++count;
+  }
+  if(count != 3 || t.edges(size_t(0)).size() != 2)
+    throw std::logic_error("Wrong number of edges");
+
+  uint32_t edge_count, edge_index;
+  if(t.GetDirectedEdges(2, edge_count, edge_index) != &des[2] || edge_count != 3 || edge_index != 2)
+    throw std::logic_error("Wrong directed edges from node 2");
+
+  // a node without edges may point just past the last edge of the tile
+  nodes[1].set_edge_index(5);
+  t.GetDirectedEdges(1, edge_count, edge_index);
+  if(edge_count != 0 || edge_index != 5)
+    throw std::logic_error("Wrong directed edges from node 1");
+
+  // edges running off the end of the tile
+  nodes[2].set_edge_count(4);
+  test::assert_throw<std::runtime_error>([&t](){ t.edges(size_t(2)); },
+    "Edges past the end of the tile should throw");
+}
+
+void departures() {
+  // schedule 0 runs every day, schedule 1 only on sundays
+  std::vector<TransitSchedule> schedules{ {0, kAllDaysOfWeek, 0}, {0, kSunday, 0} };
+  // line 0 has no departures, line 1 has 4 and line 2 has 1
+  std::vector<TransitDeparture> deps;
+  deps.emplace_back(1, 10, 0, 0, 0, 100, 60, 0, true, false);
+  deps.emplace_back(1, 11, 0, 0, 0, 200, 60, 1, true, false);
+  deps.emplace_back(1, 12, 0, 0, 0, 300, 60, 0, false, false);
+  deps.emplace_back(1, 13, 0, 0, 0, 400, 60, 0, true, true);
+  deps.emplace_back(2, 20, 0, 0, 0, 150, 60, 0, true, true);
+  testable_graphtile t(deps, schedules);
+
+  if(t.GetDepartures(0).size() != 0 || t.GetDepartures(1).size() != 4 ||
+     t.GetDepartures(2).size() != 1 || t.GetDepartures(3).size() != 0)
+    throw std::logic_error("Wrong number of departures per line");
+
+  // monday skips the sunday only departure
+  auto dep = t.GetNextDeparture(1, 150, 0, kMonday, true, false, false);
+  if(dep == nullptr || dep->tripid() != 12)
+    throw std::logic_error("Wrong next departure on monday");
+  dep = t.GetNextDeparture(1, 150, 0, kSunday, true, false, false);
+  if(dep == nullptr || dep->tripid() != 11)
+    throw std::logic_error("Wrong next departure on sunday");
+  dep = t.GetNextDeparture(1, 250, 0, kMonday, true, true, true);
+  if(dep == nullptr || dep->tripid() != 13)
+    throw std::logic_error("Wrong next accessible departure");
+  if(t.GetNextDeparture(1, 401, 0, kMonday, true, false, false) != nullptr ||
+     t.GetNextDeparture(0, 0, 0, kMonday, true, false, false) != nullptr)
+    throw std::logic_error("Should be no more departures");
+
+  auto window = t.GetDeparturesInWindow(1, 100, 300, 0, kMonday, true, false, false);
+  if(window.size() != 2 || window[0]->tripid() != 10 || window[1]->tripid() != 12)
+    throw std::logic_error("Wrong departures in window");
+  if(!t.GetDeparturesInWindow(2, 151, 1000, 0, kMonday, true, false, false).empty())
+    throw std::logic_error("Should be no departures in window");
+
+  // sundays keep every departure of line 1, mondays all but the sunday only one
+  std::vector<uint8_t> valid;
+  std::vector<const TransitDeparture*> found;
+  t.GetValidSchedules(0, kMonday, true, valid);
+  if(valid.size() != 2 || !valid[0] || valid[1])
+    throw std::logic_error("Wrong valid schedules");
+  GraphTile::FilterDepartures(t.GetDepartures(1), valid, false, false, found);
+  if(found.size() != 3 || found[0]->tripid() != 10 || found[1]->tripid() != 12 ||
+     found[2]->tripid() != 13)
+    throw std::logic_error("Wrong filtered departures");
+  found.clear();
+  t.GetValidSchedules(0, kSunday, true, valid);
+  GraphTile::FilterDepartures(t.GetDepartures(1), valid, true, true, found);
+  if(found.size() != 1 || found[0]->tripid() != 13)
+    throw std::logic_error("Wrong filtered accessible departures");
+
+  dep = t.GetTransitDeparture(1, 13);
+  if(dep == nullptr || dep->departure_time() != 400 || t.GetTransitDeparture(2, 13) != nullptr)
+    throw std::logic_error("Wrong departure by trip");
+}
+
+void frequency_departures() {
+  // every 600 seconds from 1000 to 4000 on one trip
+  TransitDeparture freq(1, 30, 0, 0, 0, 1000, 4000, 600, 60, 0, true, true);
+  if(freq.type() != kFrequencySchedule || freq.departure_time() != 1000 ||
+     freq.next_departure_time(0) != 1000 || freq.next_departure_time(1000) != 1000 ||
+     freq.next_departure_time(1001) != 1600 || freq.next_departure_time(3401) != 4000 ||
+     freq.next_departure_time(4001) != kInvalidDepartureTime)
+    throw std::logic_error("Wrong frequency departure time");
+
+  // line 1 mixes fixed departures with a frequency based one
+  std::vector<TransitSchedule> schedules{ {0, kAllDaysOfWeek, 0} };
+  std::vector<TransitDeparture> deps;
+  deps.emplace_back(1, 10, 0, 0, 0, 500, 60, 0, true, true);
+  deps.push_back(freq);
+  deps.emplace_back(1, 11, 0, 0, 0, 1700, 60, 0, true, true);
+  deps.emplace_back(1, 12, 0, 0, 0, 5000, 60, 0, true, true);
+  testable_graphtile t(deps, schedules);
+
+  // without the departure time the frequency is still found while it runs
+  auto dep = t.GetNextDeparture(1, 1200, 0, kMonday, true, false, false);
+  if(dep == nullptr || dep->tripid() != 30)
+    throw std::logic_error("Wrong next departure without its time");
+  dep = t.GetNextDeparture(1, 1650, 0, kMonday, true, false, false);
+  if(dep == nullptr || dep->tripid() != 11)
+    throw std::logic_error("Wrong next fixed departure without its time");
+  dep = t.GetNextDeparture(1, 900, 0, kMonday, true, false, false);
+  if(dep == nullptr || dep->tripid() != 30)
+    throw std::logic_error("Wrong next departure before the frequency starts");
+
+  uint32_t time;
+  dep = t.GetNextDeparture(1, 1200, 0, kMonday, true, false, false, time);
+  if(dep == nullptr || dep->tripid() != 30 || time != 1600)
+    throw std::logic_error("Wrong next frequency departure");
+  dep = t.GetNextDeparture(1, 1650, 0, kMonday, true, false, false, time);
+  if(dep == nullptr || dep->tripid() != 11 || time != 1700)
+    throw std::logic_error("Wrong next fixed departure");
+  dep = t.GetNextDeparture(1, 4001, 0, kMonday, true, false, false, time);
+  if(dep == nullptr || dep->tripid() != 12 || time != 5000)
+    throw std::logic_error("Wrong departure after the frequency ends");
+  dep = t.GetNextDeparture(1, 5001, 0, kMonday, true, false, false, time);
+  if(dep != nullptr || time != kInvalidDepartureTime)
+    throw std::logic_error("Should be no more departures");
+
+  auto window = t.GetDeparturesInWindow(1, 1650, 2200, 0, kMonday, true, false, false);
+  if(window.size() != 2 || window[0]->tripid() != 11 || window[1]->tripid() != 30)
+    throw std::logic_error("Wrong departures in window");
+}
+
+void schedule_validity() {
+  // the batch check agrees with checking one schedule at a time
+  std::mt19937 generator(11);
+  std::uniform_int_distribution<uint64_t> days;
+  std::uniform_int_distribution<uint32_t> dows(0, kAllDaysOfWeek), end_days(0, kMaxEndDay);
+  std::vector<TransitSchedule> schedules;
+  for(size_t i = 0; i < 257; ++i)
+    schedules.emplace_back(days(generator), dows(generator), end_days(generator));
+  std::vector<uint8_t> valid(schedules.size());
+  for(uint32_t day = 0; day < 100; day += 3) {
+    for(uint32_t dow : {kSunday, kWednesday, kSaturday}) {
+      for(bool before : {false, true}) {
+        TransitSchedule::IsValid(schedules.data(), schedules.size(), day, dow, before, valid.data());
+        for(size_t i = 0; i < schedules.size(); ++i)
+          if(valid[i] != schedules[i].IsValid(day, dow, before))
+            throw std::logic_error("Wrong schedule validity for day " + std::to_string(day));
+      }
+    }
+  }
+}
+
 }
 
 int main() {
@@ -76,5 +262,13 @@ int main() {
 
   suite.test(TEST_CASE(bin));
 
+  suite.test(TEST_CASE(edges));
+
+  suite.test(TEST_CASE(departures));
+
+  suite.test(TEST_CASE(frequency_departures));
+
+  suite.test(TEST_CASE(schedule_validity));
+
   return suite.tear_down();
 }
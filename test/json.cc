@@ -1,6 +1,21 @@
 #include "test.h"
+#include "baldr/directededge.h"
+#include "baldr/edgeinfo.h"
 #include "baldr/json.h"
+#include "baldr/json_arena.h"
+#include "baldr/json_reader.h"
+#include <valhalla/midgard/encoded.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <random>
 #include <set>
+#include <sstream>
+#include <vector>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
@@ -80,6 +95,298 @@ void TestJsonSerialize() {
       throw std::runtime_error("Wrong json!");
 }
 
+void TestStreamWriter() {
+  using namespace valhalla::baldr;
+  json::StreamWriter writer;
+  writer.start_map();
+  writer("name", "a \"quoted\"\tname\n");
+  writer("count", static_cast<uint64_t>(42));
+  writer("offset", static_cast<int64_t>(-7));
+  writer("distance", json::fp_t{1.23456, 3});
+  writer("closed", false);
+  writer("parent", nullptr);
+  writer.key("coords").start_array();
+  writer.start_array().value(json::fp_t{-76.5, 1}).value(json::fp_t{40.25, 2}).end_array();
+  writer.start_array().end_array();
+  writer.end_array();
+  writer.key("dom").value(json::array({std::string("x"), static_cast<uint64_t>(1), json::fp_t{2.5, 1}}));
+  writer.key("empty").start_map().end_map();
+  writer.end_map();
+
+  std::string expected = "{\"name\":\"a \\\"quoted\\\"\\tname\\n\",\"count\":42,"
+    "\"offset\":-7,\"distance\":1.235,\"closed\":false,\"parent\":null,"
+    "\"coords\":[[-76.5,40.25],[]],\"dom\":[\"x\",1,2.5],\"empty\":{}}";
+  if(writer.str() != expected)
+    throw std::runtime_error("Wrong streamed json: " + writer.str());
+
+  // Clearing lets the writer be reused
+  writer.clear();
+  writer.start_array().value(std::numeric_limits<int64_t>::min()).value(std::numeric_limits<uint64_t>::max()).end_array();
+  if(writer.str() != "[-9223372036854775808,18446744073709551615]")
+    throw std::runtime_error("Wrong streamed integers: " + writer.str());
+}
+
+void TestFpFormat() {
+  using namespace valhalla::baldr;
+  auto format = [](const json::fp_t& fp) {
+    std::stringstream stream;
+    stream << fp;
+    return stream.str();
+  };
+  auto printf_format = [](const json::fp_t& fp) {
+    char digits[512];
+    int length = snprintf(digits, sizeof(digits), "%.*Lf", static_cast<int>(fp.precision), fp.value);
+    return std::string(digits, length);
+  };
+
+  //the same text as printf, rounding ties to even
+  std::vector<json::fp_t> values{{0, 0}, {0.5, 0}, {1.5, 0}, {0.125, 2}, {2.675, 2},
+    {-76.5, 1}, {-0.0001, 3}, {-0.0, 2}, {40.7127753, 6}, {-73.9865812, 6}, {1e17, 1},
+    {123456789.987654321, 9}, {0.8, 1}, {1e300, 2}, {1e-300, 18}, {3.5, 25}};
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> distribution(-180, 180);
+  for(size_t i = 0; i < 10000; ++i)
+    values.push_back({distribution(generator), i % 8});
+  for(const auto& value : values)
+    if(format(value) != printf_format(value))
+      throw std::runtime_error("Wrong fixed text: " + format(value) + " vs " + printf_format(value));
+
+  //the fewest digits that read back the same
+  if(format({0.1, json::kShortest}) != "0.1" || format({-2.5, json::kShortest}) != "-2.5" ||
+     format({0.1 + 0.2, json::kShortest}) != "0.30000000000000004" ||
+     format({1e-7, json::kShortest}) != "1e-07")
+    throw std::runtime_error("Wrong shortest text");
+
+  //too little room says how much is needed
+  char small[4];
+  if(json::to_chars({3.14159, 4}, small, sizeof(small)) != 6)
+    throw std::runtime_error("Wrong length when out of room");
+}
+
+void TestFpHalfway() {
+  using namespace valhalla::baldr;
+  //what to_chars replaced, std::fixed on the exact value
+  auto fixed_format = [](const json::fp_t& fp) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(fp.precision) << fp.value;
+    return stream.str();
+  };
+  auto format = [](const json::fp_t& fp) {
+    char digits[512];
+    return std::string(digits, json::to_chars(fp, digits, sizeof(digits)));
+  };
+
+  //coordinates which sit on or right next to a half way point once scaled,
+  //as doubles and as the floats they often start out as
+  std::vector<double> values{-158.205861, 36.080663, 0.0000005, 2.5, 1.0000005, -0.00000125};
+  std::mt19937 generator(42);
+  for(size_t precision = 0; precision <= 9; ++precision) {
+    double scale = std::pow(10.0, precision);
+    std::uniform_int_distribution<int64_t> scaled(-180 * scale, 180 * scale);
+    for(size_t i = 0; i < 2000; ++i) {
+      double halfway = (scaled(generator) + 0.5) / scale;
+      double below = halfway, above = halfway;
+      for(size_t ulps = 0; ulps < 3; ++ulps) {
+        values.push_back(below = std::nextafter(below, -HUGE_VAL));
+        values.push_back(above = std::nextafter(above, HUGE_VAL));
+      }
+      values.push_back(halfway);
+    }
+  }
+  for(const auto value : values) {
+    for(size_t precision = 0; precision <= 9; ++precision) {
+      for(const auto fp : {json::fp_t{value, precision}, json::fp_t{static_cast<float>(value), precision}}) {
+        if(format(fp) != fixed_format(fp))
+          throw std::runtime_error("Wrong half way text: " + format(fp) + " vs " + fixed_format(fp));
+      }
+    }
+  }
+}
+
+//maps from the dom come out in hash order, compare them regardless of order
+boost::property_tree::ptree parse_sorted(const std::string& text) {
+  std::stringstream stream(text);
+  boost::property_tree::ptree tree;
+  boost::property_tree::read_json(stream, tree);
+  std::function<void (boost::property_tree::ptree&)> sort = [&sort](boost::property_tree::ptree& node) {
+    for(auto& child : node)
+      sort(child.second);
+    node.sort([](const boost::property_tree::ptree::value_type& a, const boost::property_tree::ptree::value_type& b) {
+      return a.first < b.first;
+    });
+  };
+  sort(tree);
+  return tree;
+}
+
+template <class T>
+void check_serializers_agree(const T& object, const std::string& name) {
+  using namespace valhalla::baldr;
+  std::stringstream dom;
+  dom << *object.json();
+  json::StreamWriter writer;
+  object.json(writer);
+  if(parse_sorted(dom.str()) != parse_sorted(writer.str()))
+    throw std::runtime_error(name + " json differs: " + dom.str() + " vs " + writer.str());
+}
+
+void TestSerializersAgree() {
+  using namespace valhalla::baldr;
+  DirectedEdge edge;
+  edge.set_endnode(GraphId(1234, 2, 56));
+  edge.set_length(4321);
+  edge.set_weighted_grade(9);
+  edge.set_speed(65);
+  edge.set_toll(true);
+  edge.set_tunnel(true);
+  edge.set_cyclelane(CycleLane::kShared);
+  edge.set_bike_network(kMcn | kRcn);
+  edge.set_lanecount(3);
+  edge.set_use(Use::kRamp);
+  edge.set_forwardaccess(kAutoAccess | kBicycleAccess);
+  edge.set_classification(RoadClass::kPrimary);
+  edge.set_surface(Surface::kGravel);
+  edge.set_link(true);
+  check_serializers_agree(edge, "DirectedEdge");
+
+  //way id, two names which need escaping and a shape
+  const char names[] = "Main \"St\"\0Route\t1";
+  std::string encoded = valhalla::midgard::encode7(std::vector<valhalla::midgard::PointLL>{
+    {-76.299222f, 40.042112f}, {-76.298702f, 40.043011f}});
+  NameInfo name_infos[2] = {};
+  name_infos[1].name_offset_ = 10;
+  EdgeInfo::PackedItem item{};
+  item.name_count = 2;
+  item.encoded_shape_size = encoded.size();
+  uint64_t wayid = 987654321;
+  std::vector<char> mem;
+  mem.insert(mem.end(), reinterpret_cast<const char*>(&wayid), reinterpret_cast<const char*>(&wayid + 1));
+  mem.insert(mem.end(), reinterpret_cast<const char*>(&item), reinterpret_cast<const char*>(&item + 1));
+  mem.insert(mem.end(), reinterpret_cast<const char*>(name_infos), reinterpret_cast<const char*>(name_infos + 2));
+  mem.insert(mem.end(), encoded.begin(), encoded.end());
+  EdgeInfo info(mem.data(), names, sizeof(names));
+  if(info.GetNames() != std::vector<std::string>{"Main \"St\"", "Route\t1"})
+    throw std::runtime_error("Wrong edge info names");
+  check_serializers_agree(info, "EdgeInfo");
+}
+
+void TestArenaDom() {
+  using namespace valhalla::baldr;
+  //small blocks so the document spans a few of them
+  json::Arena arena(256);
+  auto& feature = arena.map();
+  feature.emplace("type", "Feature");
+  feature.emplace("id", static_cast<uint64_t>(7));
+  auto& geometry = feature.map("geometry");
+  geometry.emplace("type", std::string("LineString"));
+  auto& coordinates = geometry.array("coordinates");
+  for(int i = 0; i < 3; ++i)
+    coordinates.array().push_back(json::fp_t{-76.5 + i, 1}).push_back(json::fp_t{40.25, 2});
+  auto& properties = feature.map("properties");
+  properties.emplace("name", "a \"quoted\" name");
+  properties.emplace("offset", static_cast<int64_t>(-3));
+  properties.emplace("closed", false);
+  properties.emplace("parent", nullptr);
+  properties.array("names");
+
+  //keys come out in the order they went in
+  std::stringstream result;
+  result << feature;
+  std::string expected = "{\"type\":\"Feature\",\"id\":7,\"geometry\":{\"type\":\"LineString\","
+    "\"coordinates\":[[-76.5,40.25],[-75.5,40.25],[-74.5,40.25]]},\"properties\":{"
+    "\"name\":\"a \\\"quoted\\\" name\",\"offset\":-3,\"closed\":false,\"parent\":null,\"names\":[]}}";
+  if(result.str() != expected)
+    throw std::runtime_error("Wrong arena json: " + result.str());
+
+  //lookups
+  const auto* id = feature.find("id");
+  if(id == nullptr || id->type() != json::ArenaValue::Type::Unsigned || id->get_unsigned() != 7 ||
+     feature.find("missing") != nullptr || feature.find("geometry")->get_map().size() != 2 ||
+     feature.find("geometry")->get_map().find("coordinates")->get_array()[2].get_array()[0].get_fp().value != -74.5 ||
+     properties.find("name")->get_string().str() != "a \"quoted\" name")
+    throw std::runtime_error("Wrong arena lookups");
+
+  //growing well past the first allocation, and past a block
+  arena.clear();
+  auto& big = arena.map();
+  auto& list = big.array("list");
+  for(uint64_t i = 0; i < 1000; ++i) {
+    big.emplace(std::to_string(i), i);
+    list.push_back(i);
+  }
+  if(big.size() != 1001 || list.size() != 1000 || list[999].get_unsigned() != 999 ||
+     big.find("500")->get_unsigned() != 500 || (big.begin() + 1)->key.str() != "0")
+    throw std::runtime_error("Wrong grown arena json");
+
+  //embedding in a streamed document
+  json::StreamWriter writer;
+  writer.start_map();
+  writer.key("list");
+  list.write(writer);
+  writer.end_map();
+  if(writer.str().substr(0, 16) != "{\"list\":[0,1,2,3")
+    throw std::runtime_error("Wrong streamed arena json");
+}
+
+void TestReader() {
+  using namespace valhalla::baldr;
+  std::string text = " {\"a\" : [1, -2.5e1, \"x\\\"y\\u00e9\\ud83d\\ude00\", true, null, {}], \"b\":{\"c\":[[]]}, \"d\":0.1}  ";
+  json::Reader reader(text);
+  reader.start_map();
+  json::Slice key;
+  if(!reader.next_key(key) || key != "a")
+    throw std::runtime_error("Wrong first key");
+  reader.start_array();
+  if(!reader.next_element() || reader.peek() != json::Reader::Type::Number || reader.number() != 1)
+    throw std::runtime_error("Wrong first element");
+  if(!reader.next_element() || reader.number() != -25)
+    throw std::runtime_error("Wrong second element");
+  if(!reader.next_element() || reader.string().str() != "x\"y\xC3\xA9\xF0\x9F\x98\x80")
+    throw std::runtime_error("Wrong escaped string");
+  if(!reader.next_element() || !reader.boolean())
+    throw std::runtime_error("Wrong bool");
+  if(!reader.next_element() || reader.scalar() != "null")
+    throw std::runtime_error("Wrong null");
+  if(!reader.next_element() || reader.peek() != json::Reader::Type::Map)
+    throw std::runtime_error("Wrong nested map");
+  reader.skip();
+  if(reader.next_element())
+    throw std::runtime_error("Wrong end of array");
+  if(!reader.next_key(key) || key != "b")
+    throw std::runtime_error("Wrong second key");
+  reader.skip();
+  if(!reader.next_key(key) || key != "d" || reader.number() != 0.1 || reader.next_key(key))
+    throw std::runtime_error("Wrong last key");
+  reader.finish();
+
+  //numbers on and off the fast path read the same as strtod
+  for(const char* number : {"0", "-0.5", "40.748174", "-73.984984", "123456789012345678",
+      "1.7976931348623157e308", "4.9e-324", "0.1e-30", "12345678901234567890123", "2e22", "9007199254740993"}) {
+    if(json::Reader::to_double({number, strlen(number)}) != strtod(number, nullptr))
+      throw std::runtime_error(std::string("Wrong number ") + number);
+  }
+  int64_t integer;
+  uint64_t natural;
+  if(!json::Reader::to_integer({"-9223372036854775808", 20}, integer) || integer != std::numeric_limits<int64_t>::min() ||
+     json::Reader::to_integer({"9223372036854775808", 19}, integer) || json::Reader::to_integer({"1.5", 3}, integer) ||
+     !json::Reader::to_unsigned({"18446744073709551615", 20}, natural) || natural != std::numeric_limits<uint64_t>::max() ||
+     json::Reader::to_unsigned({"18446744073709551616", 20}, natural) || json::Reader::to_unsigned({"-1", 2}, natural))
+    throw std::runtime_error("Wrong integers");
+
+  //malformed json
+  for(const char* bad : {"{\"a\" 1}", "[1,]", "[1 2]", "{\"a\":01}", "[\"\\q\"]", "[tru]", "[1] x", "\"abc", "[-]", "{,}"}) {
+    try {
+      json::Reader bad_reader(bad, strlen(bad));
+      bad_reader.skip();
+      bad_reader.finish();
+    }
+    catch(const std::runtime_error&) {
+      continue;
+    }
+    throw std::runtime_error(std::string("Should not have read ") + bad);
+  }
+}
+
 }
 
 int main() {
@@ -87,5 +394,17 @@ int main() {
 
   suite.test(TEST_CASE(TestJsonSerialize));
 
+  suite.test(TEST_CASE(TestStreamWriter));
+
+  suite.test(TEST_CASE(TestFpFormat));
+
+  suite.test(TEST_CASE(TestFpHalfway));
+
+  suite.test(TEST_CASE(TestSerializersAgree));
+
+  suite.test(TEST_CASE(TestArenaDom));
+
+  suite.test(TEST_CASE(TestReader));
+
   return suite.tear_down();
 }
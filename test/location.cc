@@ -5,6 +5,7 @@
 #include <valhalla/midgard/util.h>
 #include <valhalla/midgard/logging.h>
 
+#include <sstream>
 #include <unordered_map>
 
 using namespace std;
@@ -199,6 +200,57 @@ void test_from_json() {
     throw std::runtime_error("Json location parsing failed");
 }
 
+void test_from_json_array() {
+  // The same locations as FromJson, in any key order, extra keys skipped
+  std::string json = " [" + make_json(40.748174, -73.984984, "through", 200, "Empire \\\"State\\\"") +
+    ", {\"name\":\"x\",\"options\":{\"a\":[1,{\"b\":null}]},\"lon\":\"-380.5\",\"lat\":\"1.5\","
+    "\"heading\":\"90.5\",\"way_id\":\"12987234107\",\"date_time\":\"current\"} ] ";
+  auto locations = Location::FromJsonArray(json);
+  if (locations.size() != 2)
+    throw std::runtime_error("Json location array parsing failed");
+  if (!(locations[0] == Location::FromJson(make_json(40.748174, -73.984984, "through", 200, "Empire \\\"State\\\""))) ||
+      locations[0].name_ != "Empire \"State\"" || locations[0].stoptype_ != Location::StopType::THROUGH ||
+      *locations[0].heading_ != 200)
+    throw std::runtime_error("Json location array parsing failed");
+  if (!valhalla::midgard::equal<float>(locations[1].latlng_.lat(), 1.5f) ||
+      !valhalla::midgard::equal<float>(locations[1].latlng_.lng(), -20.5f) ||
+      locations[1].heading_ || *locations[1].way_id_ != 12987234107 ||
+      *locations[1].date_time_ != "current" || locations[1].name_ != "x")
+    throw std::runtime_error("Json location array parsing failed");
+
+  // Agrees with the property tree
+  std::stringstream stream;
+  stream << make_json(-33.8688, 151.2093, "break", 45, "Sydney", "", "", "NSW", "2000", "AU", 7, std::string("2016-01-01T00:00"));
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(stream, pt);
+  if (!(Location::FromPtree(pt) == Location::FromJson(stream.str())))
+    throw std::runtime_error("Json location parsing disagrees with ptree");
+
+  // Including the first of repeated keys winning and maps or arrays as text
+  std::string odd = "{\"lat\":1.5,\"lon\":2.5,\"lat\":3.5,\"name\":{\"a\":1},\"street\":[1,2],"
+    "\"heading\":{\"x\":1},\"type\":\"through\",\"type\":\"break\",\"date_time\":[\"x\"],"
+    "\"city\":\"a\",\"city\":\"b\",\"way_id\":7,\"way_id\":8}";
+  std::stringstream odd_stream(odd);
+  boost::property_tree::read_json(odd_stream, pt);
+  auto odd_location = Location::FromJson(odd);
+  if (!(Location::FromPtree(pt) == odd_location) || odd_location.city_ != "a" ||
+      odd_location.stoptype_ != Location::StopType::THROUGH || *odd_location.way_id_ != 7 ||
+      !odd_location.name_.empty() || odd_location.heading_ || *odd_location.date_time_ != "")
+    throw std::runtime_error("Json location parsing disagrees with ptree on odd input");
+
+  if (!Location::FromJsonArray("[]").empty())
+    throw std::runtime_error("Empty json location array parsing failed");
+  for (const auto& bad : {"[{\"lat\":1}]", "[{\"lat\":91,\"lon\":1}]", "{\"lat\":1,\"lon\":1}",
+       "[{\"lat\":1,\"lon\":1}", "[{\"lat\":\"a\",\"lon\":1}]"}) {
+    try {
+      Location::FromJsonArray(bad);
+    } catch (const std::runtime_error&) {
+      continue;
+    }
+    throw std::runtime_error(std::string("This should have been a bad json location array ") + bad);
+  }
+}
+
 void test_hashing() {
 
   Location a({123.456789,9.87654321},Location::StopType::BREAK);
@@ -227,6 +279,8 @@ int main(void) {
 
   suite.test(TEST_CASE(test_from_json));
 
+  suite.test(TEST_CASE(test_from_json_array));
+
   suite.test(TEST_CASE(test_hashing));
 
   return suite.tear_down();
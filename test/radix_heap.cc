@@ -0,0 +1,109 @@
+#include "test.h"
+#include <vector>
+#include <algorithm>
+#include "config.h"
+#include "baldr/radix_heap.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct label_cost_t {
+  const std::vector<float>* costs;
+  float operator()(const uint32_t label) const {
+    return (*costs)[label];
+  }
+};
+
+using heap_t = RadixHeap<uint32_t, label_cost_t>;
+
+void TryAddRemove(heap_t& adjlist, std::vector<float>& edgelabels,
+                  const std::vector<float>& costs) {
+  edgelabels = costs;
+  for (uint32_t i = 0; i < costs.size(); i++) {
+    adjlist.add(i, costs[i]);
+  }
+  std::vector<float> expectedorder = costs;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (auto expected : expectedorder) {
+    uint32_t labelindex = adjlist.pop();
+    if (labelindex == heap_t::invalid() || edgelabels[labelindex] != expected) {
+      throw runtime_error("TryAddRemove: expected order test failed");
+    }
+  }
+  if (adjlist.pop() != heap_t::invalid()) {
+    throw runtime_error("TryAddRemove: expected an empty heap");
+  }
+}
+
+void TestAddRemove() {
+  // Fractional and sparse costs come out in exact order
+  std::vector<float> edgelabels;
+  heap_t adjlist(label_cost_t{&edgelabels});
+  TryAddRemove(adjlist, edgelabels, { 67, 325, 25, 466, 1000, 100005, 758,
+            167, 258, 16442, 278, 111111000, 0, 25.5f, 25.25f, 1e-3f });
+
+  adjlist.clear();
+  TryAddRemove(adjlist, edgelabels, { 5, 30000, 8, 3, 9999 });
+}
+
+void TestMonotone() {
+  // Labels added while popping, as a label setting search does
+  std::vector<float> edgelabels = { 10, 20 };
+  heap_t adjlist(label_cost_t{&edgelabels});
+  adjlist.add(0, 10);
+  adjlist.add(1, 20);
+  if (adjlist.pop() != 0)
+    throw runtime_error("TestMonotone: expected label 0");
+  edgelabels.push_back(15);
+  adjlist.add(2, 15);
+  edgelabels.push_back(10);
+  adjlist.add(3, 10);
+  if (adjlist.pop() != 3 || adjlist.pop() != 2 || adjlist.pop() != 1 ||
+      adjlist.pop() != heap_t::invalid())
+    throw runtime_error("TestMonotone: wrong order");
+}
+
+void TestDecreaseCost() {
+  std::vector<float> edgelabels = { 67, 325, 25, 466, 1000, 100005, 758, 167,
+            258, 16442, 278, 111111000 };
+  heap_t adjlist(label_cost_t{&edgelabels});
+  for (uint32_t i = 0; i < edgelabels.size(); i++) {
+    adjlist.add(i, edgelabels[i]);
+  }
+  std::vector<std::pair<uint32_t, float>> decreases = { {11, 20000},
+            {5, 300}, {4, 999.5f}, {6, 10}, {11, 15} };
+  for (const auto& d : decreases) {
+    float previous = edgelabels[d.first];
+    edgelabels[d.first] = d.second;
+    adjlist.decrease(d.first, d.second, previous);
+  }
+
+  // Every label comes out once in order of its decreased cost
+  std::vector<float> expectedorder = edgelabels;
+  std::sort(expectedorder.begin(), expectedorder.end());
+  for (auto expected : expectedorder) {
+    uint32_t labelindex = adjlist.pop();
+    if (labelindex == heap_t::invalid() || edgelabels[labelindex] != expected) {
+      throw runtime_error("TestDecreaseCost: expected order test failed");
+    }
+  }
+  if (adjlist.pop() != heap_t::invalid()) {
+    throw runtime_error("TestDecreaseCost: label returned more than once");
+  }
+}
+
+}
+
+int main() {
+  test::suite suite("radix_heap");
+
+  suite.test(TEST_CASE(TestAddRemove));
+
+  suite.test(TEST_CASE(TestMonotone));
+
+  suite.test(TEST_CASE(TestDecreaseCost));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,68 @@
+#include "test.h"
+#include "graph_tile_builder.h"
+
+#include "baldr/graphreader.h"
+#include "baldr/nodeinfo.h"
+#include "baldr/directededge.h"
+#include "baldr/edgeinfo.h"
+#include "baldr/way_index.h"
+
+#include <cstring>
+
+namespace vb = valhalla::baldr;
+
+namespace {
+
+using test::graph_tile_builder;
+using test::test_graph_reader;
+
+void TestWayIndex() {
+  vb::GraphId a(0, 2, 0), b(1, 2, 0);
+
+  // way 7 crosses from tile a into tile b, way 3 is only in tile a and
+  // way 9 is only in tile b
+  graph_tile_builder builder;
+  builder.append_node(0.f, 0.f, 2, 0);
+  builder.append_node(0.f, 0.f, 1, 2);
+  builder.append_edge(a + uint64_t(1), 100, 7);
+  builder.append_edge(a + uint64_t(1), 100, 3);
+  builder.append_edge(a, 100, 3);
+  builder.commit_tile(a);
+  builder.append_node(0.f, 0.f, 2, 0);
+  builder.append_edge(b, 100, 9);
+  builder.append_edge(b, 100, 7);
+  builder.commit_tile(b);
+
+  test_graph_reader reader(std::move(builder.tiles));
+  std::vector<vb::GraphId> tiles = {a, b};
+  vb::way_index_t index(reader, tiles);
+  if (index.size() != 4)
+    throw std::runtime_error("Expected 4 (way, tile) pairs");
+
+  // per tile
+  auto edges = reader.GetGraphTile(a)->GetEdgesForWay(3);
+  if (edges.size() != 2 || edges[0] != a + uint64_t(1) || edges[1] != a + uint64_t(2))
+    throw std::runtime_error("Wrong edges for way 3");
+  if (!reader.GetGraphTile(a)->GetEdgesForWay(9).empty())
+    throw std::runtime_error("Way 9 is not in tile a");
+  if (reader.GetGraphTile(b)->GetWayIds() != std::vector<uint64_t>{7, 9})
+    throw std::runtime_error("Wrong ways in tile b");
+
+  // global
+  if (index.tiles(7) != std::vector<vb::GraphId>{a, b})
+    throw std::runtime_error("Way 7 should be in both tiles");
+  if (index.edges(7, reader) != std::vector<vb::GraphId>{a, b + uint64_t(1)})
+    throw std::runtime_error("Wrong edges for way 7");
+  if (!index.tiles(42).empty() || !index.edges(42, reader).empty())
+    throw std::runtime_error("Way 42 shouldnt be anywhere");
+}
+
+}
+
+int main() {
+  test::suite suite("way_index");
+
+  suite.test(TEST_CASE(TestWayIndex));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,266 @@
+#ifndef VALHALLA_BALDR_BUCKET_QUEUE_H_
+#define VALHALLA_BALDR_BUCKET_QUEUE_H_
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Bucket Queue. The same double bucket sort as DoubleBucketQueue, templated
+ * on the label type and the cost functor so the cost lookup can be inlined.
+ * Buckets are vectors which keep their capacity when cleared, so a queue
+ * reused across queries stops allocating once it has warmed up. clear()
+ * only visits the buckets touched since the last clear.
+ *
+ * decrease is O(1): the label is added to its new bucket and the entry left
+ * in its previous bucket is skipped when popped. Labels must be dense
+ * indexes into external data as the bucket of each label is tracked.
+ */
+template <typename label_t, typename labelcost_t>
+class BucketQueue {
+ public:
+  /**
+   * Constructor given a minimum cost, a range of costs held within the
+   * bucket sort, and a bucket size. All costs above mincost + range are
+   * stored in an "overflow" bucket.
+   * @param mincost    Minimum cost. Used to create the initial range for
+   *                   bucket sorting.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   *                   Must be an integer value.
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  BucketQueue(const float mincost, const float range,
+              const uint32_t bucketsize, const labelcost_t& labelcost)
+      : bucketrange_(range), bucketsize_(static_cast<float>(bucketsize)),
+        inv_(1.0f / bucketsize), labelcost_(labelcost) {
+    // Adjust min cost to be the start of a bucket
+    uint32_t c = static_cast<uint32_t>(mincost);
+    startcost_ = static_cast<float>(c - (c % bucketsize));
+    startmax_ = mincost + bucketrange_;
+
+    // Allocate the low-level buckets plus the overflow bucket
+    overflow_ = static_cast<uint32_t>(std::ceil((startmax_ - startcost_) * inv_)) + 1;
+    buckets_.resize(overflow_ + 1);
+    reset();
+  }
+
+  /**
+   * Returned by pop when the queue is empty.
+   * @return  Returns the invalid label.
+   */
+  static constexpr label_t invalid() {
+    return std::numeric_limits<label_t>::max();
+  }
+
+  /**
+   * Clear all labels from the low-level buckets and the overflow bucket.
+   * Only the buckets touched since the last clear are visited.
+   */
+  void clear() {
+    for (auto idx : touched_) {
+      for (auto label : buckets_[idx]) {
+        label_buckets_[static_cast<size_t>(label)] = kUnqueued;
+      }
+      buckets_[idx].clear();
+    }
+    touched_.clear();
+    reset();
+  }
+
+  /**
+   * Adds a label index to the bucketed sort. Adds it to the appropriate bucket
+   * given the cost. If the cost is greater than maxcost_ the label
+   * is placed in the overflow bucket. If the cost is < the current bucket
+   * cost then the label is placed in the current bucket to prevent underflow.
+   * @param   label  Label index to add to the adjacency list.
+   * @param   cost   Cost for this label.
+   */
+  void add(const label_t label, const float cost) {
+    size_t l = static_cast<size_t>(label);
+    if (l >= label_buckets_.size()) {
+      label_buckets_.resize(l + 1, kUnqueued);
+    }
+    push(label, bucket_index(cost));
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Adds it to the bucket
+   * of its new cost, the entry in its previous bucket is skipped on pop.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   * @param  previouscost Previous cost (unused, kept for compatibility with
+   *                      DoubleBucketQueue).
+   */
+  void decrease(const label_t label, const float newcost,
+                const float /*previouscost*/ = 0.0f) {
+    uint32_t idx = bucket_index(newcost);
+    if (label_buckets_[static_cast<size_t>(label)] != idx) {
+      push(label, idx);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the sorted buckets.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          invalid() if the buckets are empty.
+   */
+  label_t pop() {
+    label_t label = pop_bucket();
+    while (label == invalid() && !buckets_[overflow_].empty()) {
+      empty_overflow();
+      label = pop_bucket();
+    }
+    return label;
+  }
+
+ private:
+  // Marks labels that are not in the queue
+  static constexpr uint32_t kUnqueued = std::numeric_limits<uint32_t>::max();
+
+  float bucketrange_;  // Total range of costs in lower level buckets
+  float bucketsize_;   // Bucket size (range of costs in same bucket)
+  float inv_;          // 1/bucketsize (so we can avoid division)
+  float startcost_;    // Minimum cost of the low level buckets after clear
+  float startmax_;     // Maximum cost of the low level buckets after clear
+  float mincost_;      // Minimum cost within the low level buckets
+  float maxcost_;      // Above this goes into overflow bucket
+  float currentcost_;  // Current cost
+
+  // Low level buckets followed by the overflow bucket
+  std::vector<std::vector<label_t> > buckets_;
+  uint32_t overflow_;  // Index of the overflow bucket
+  uint32_t current_;   // Index of the current bucket
+  size_t head_;        // Next label to pop within the current bucket
+
+  // Buckets that became non-empty since the last clear
+  std::vector<uint32_t> touched_;
+
+  // Bucket index each label is currently queued in
+  std::vector<uint32_t> label_buckets_;
+
+  // Labels being moved out of the overflow bucket
+  std::vector<label_t> spare_;
+
+  // Cost function to get cost given the label index.
+  labelcost_t labelcost_;
+
+  /**
+   * Resets the cost range and current bucket to their initial state.
+   */
+  void reset() {
+    mincost_ = startcost_;
+    maxcost_ = startmax_;
+    currentcost_ = mincost_;
+    current_ = 0;
+    head_ = 0;
+  }
+
+  /**
+   * Returns the index of the bucket given the cost.
+   * @param  cost  Cost.
+   * @return Returns the index of the bucket that the cost lies within.
+   */
+  uint32_t bucket_index(const float cost) const {
+    return (cost < currentcost_) ? current_ :
+             (cost < maxcost_) ?
+               static_cast<uint32_t>((cost - mincost_) * inv_) :
+               overflow_;
+  }
+
+  /**
+   * Adds a label to a bucket and records the bucket it is queued in.
+   * @param  label  Label index.
+   * @param  idx    Bucket index.
+   */
+  void push(const label_t label, const uint32_t idx) {
+    auto& bucket = buckets_[idx];
+    if (bucket.empty()) {
+      touched_.push_back(idx);
+    }
+    bucket.push_back(label);
+    label_buckets_[static_cast<size_t>(label)] = idx;
+  }
+
+  /**
+   * Removes the lowest cost label index from the low level buckets. Buckets
+   * are emptied (keeping their capacity) once all their labels are popped.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          invalid() if the low level buckets are empty.
+   */
+  label_t pop_bucket() {
+    while (true) {
+      auto& bucket = buckets_[current_];
+      while (head_ < bucket.size()) {
+        // Skip labels that have since moved to a lower bucket or were popped
+        label_t label = bucket[head_++];
+        auto& queued = label_buckets_[static_cast<size_t>(label)];
+        if (queued == current_) {
+          queued = kUnqueued;
+          return label;
+        }
+      }
+      bucket.clear();
+      head_ = 0;
+
+      // Stay on the last bucket - in case another access of the adjacency
+      // list is done
+      if (current_ + 1 == overflow_) {
+        return invalid();
+      }
+      current_++;
+      currentcost_ += bucketsize_;
+    }
+  }
+
+  /**
+   * Empties the overflow bucket by placing the label indexes into the
+   * low level buckets.
+   */
+  void empty_overflow() {
+    // All low level buckets are empty at this point
+    touched_.clear();
+    auto& overflow = buckets_[overflow_];
+    bool found = false;
+    while (!found && !overflow.empty()) {
+      // Adjust cost range
+      mincost_ += bucketrange_;
+      maxcost_ += bucketrange_;
+      currentcost_ = mincost_;
+      current_ = 0;
+      head_ = 0;
+
+      // Move labels within the new range to the low level buckets. Drop
+      // labels that have since moved to a low level bucket.
+      spare_.swap(overflow);
+      for (auto label : spare_) {
+        if (label_buckets_[static_cast<size_t>(label)] != overflow_) {
+          continue;
+        }
+        float cost = labelcost_(label);
+        if (cost < maxcost_) {
+          push(label, static_cast<uint32_t>((cost - mincost_) * inv_));
+          found = true;
+        } else {
+          overflow.push_back(label);
+        }
+      }
+      spare_.clear();
+    }
+    if (!overflow.empty()) {
+      touched_.push_back(overflow_);
+    }
+  }
+};
+
+template <typename label_t, typename labelcost_t>
+constexpr uint32_t BucketQueue<label_t, labelcost_t>::kUnqueued;
+
+}
+}
+
+#endif  // VALHALLA_BALDR_BUCKET_QUEUE_H_
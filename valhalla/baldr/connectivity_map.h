@@ -5,21 +5,109 @@
 #include <valhalla/baldr/pathlocation.h>
 
 #include <vector>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <cstdint>
 
 namespace valhalla {
   namespace baldr {
+    class GraphReader;
+    class GraphTile;
+
+    /**
+     * Labels the directed edges of the graph with the strongly connected
+     * component, for one access mode, which they lie within. Edges which are
+     * not traversable by the mode or which lead from one component to another
+     * have no component. Unlike the tile colors this can tell that two places
+     * in the same tile are on islands which can't reach each other.
+     *
+     * Components are found with an iterative Tarjan's algorithm over the nodes,
+     * reading every tile through the reader, so the reader needs to be able to
+     * hold the whole graph. It uses 4 bytes per directed edge plus 12 bytes
+     * per node while computing.
+     */
+    class component_map_t {
+     public:
+      static constexpr uint32_t kNoComponent = std::numeric_limits<uint32_t>::max();
+
+      /**
+       * Computes the components of the graph in the given tiles
+       * @param reader  the graph
+       * @param tiles   the tiles of the graph, in the order components are numbered
+       * @param access  the access mask of the mode (kAutoAccess etc)
+       */
+      component_map_t(GraphReader& reader, const std::vector<GraphId>& tiles, uint32_t access);
+
+      /**
+       * Computes the components of the graph in tiles which are already loaded.
+       * The tiles are only read, so several modes can be computed at once from
+       * the same tiles
+       * @param tiles   the tiles of the graph, in the order components are numbered
+       * @param access  the access mask of the mode (kAutoAccess etc)
+       */
+      component_map_t(const std::vector<const GraphTile*>& tiles, uint32_t access);
+
+      /**
+       * Returns the component of the given directed edge
+       *
+       * @param edge       the directed edge graphid
+       * @return component the component or kNoComponent if the edge lies between components
+       *                   or isn't traversable by the mode
+       */
+      uint32_t get_component(const GraphId& edge) const;
+
+      /**
+       * Returns whether a route could go from a to b and back again. Both must
+       * have a correlated edge within the same component, even if they share an
+       * edge, as an edge without a component can't be followed both ways. Never
+       * false when a route exists, may be true when none does as restrictions
+       * aren't considered.
+       *
+       * @param a        a correlated location
+       * @param b        another correlated location
+       * @return bool    false if there is no route from a to b or from b to a
+       */
+      bool mutually_reachable(const baldr::PathLocation& a, const baldr::PathLocation& b) const;
+
+      /**
+       * Returns the number of components, including single nodes
+       */
+      size_t component_count() const;
+
+      /**
+       * Returns the access mask of the mode
+       */
+      uint32_t access() const;
+
+     private:
+      //index of the first edge of each tile in edge_components, by level then tile id
+      std::vector<std::vector<uint64_t> > edge_offsets;
+      std::vector<uint32_t> edge_components;
+      size_t count;
+      uint32_t access_mask;
+    };
+
     //TODO: maintain consistent coloring of regions despite the connectivity changing
     class connectivity_map_t {
      public:
       /**
-       * Constructs the connectivity map
+       * Constructs the connectivity map. If the config has a connectivity_cache path
+       * the colors are read from it when it was written for the same set of tiles,
+       * otherwise they are computed and written to it
        * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
        */
       connectivity_map_t(const boost::property_tree::ptree& pt);
 
+      /**
+       * Constructs the connectivity map and the component maps of the given modes.
+       * The tiles are loaded once into one reader and each mode is computed from
+       * them on its own thread, so the whole graph needs to fit in memory once
+       * @param pt            the ptree sub child labeled mjolnir in the valhalla json config
+       * @param access_modes  the access masks of the modes to compute components for
+       */
+      connectivity_map_t(const boost::property_tree::ptree& pt, const std::vector<uint32_t>& access_modes);
+
       /**
        * Returns the color for the given graphid
        *
@@ -32,9 +120,9 @@ namespace valhalla {
        * Returns the colors for the given level,point,radius
        *
        * @param hierarchy_level  the hierarchy level whos connectivity you are querying
-       * @param center           the center of the circle
-       * @param radius           the radius of the circle
-       * @return colors          the colors of the tiles that intersect this circle at this level
+       * @param location         the location whose correlated points are the centers of the circles
+       * @param radius           the radius of the circles in meters
+       * @return colors          the colors of the tiles that intersect these circles at this level
        */
       std::unordered_set<size_t> get_colors(uint32_t hierarchy_level, const baldr::PathLocation& location, float radius) const;
 
@@ -54,11 +142,51 @@ namespace valhalla {
        */
       std::vector<size_t> to_image(const uint32_t hierarchy_level) const;
 
+      /**
+       * Returns the component of a directed edge for a mode
+       *
+       * @param edge       the directed edge graphid
+       * @param access     the access mask of the mode
+       * @return component the component or component_map_t::kNoComponent if the edge lies
+       *                   between components or the mode's components weren't computed
+       */
+      uint32_t get_component(const GraphId& edge, uint32_t access) const;
+
+      /**
+       * Returns whether a route could go from a to b and back again for a mode. Uses
+       * the components of the mode if they were computed, otherwise the tile colors
+       *
+       * @param a        a correlated location
+       * @param b        another correlated location
+       * @param access   the access mask of the mode
+       * @return bool    false if there is no route from a to b or from b to a
+       */
+      bool mutually_reachable(const baldr::PathLocation& a, const baldr::PathLocation& b, uint32_t access) const;
+
      private:
+      /**
+       * Reads the colors from a cache file
+       *
+       * @param file         the cache file
+       * @param fingerprint  the fingerprint of the tile set the cache must have been written for
+       * @return bool        true if the colors were read
+       */
+      bool read_colors(const std::string& file, uint64_t fingerprint);
+
+      /**
+       * Writes the colors to a cache file
+       *
+       * @param file         the cache file
+       * @param fingerprint  the fingerprint of the tile set the colors were computed for
+       */
+      void write_colors(const std::string& file, uint64_t fingerprint) const;
+
       uint32_t transit_level;
       //this is a map(tile_level, map(tile_id, tile_color))
       std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t> > colors;
       TileHierarchy tile_hierarchy;
+      //the edge components keyed by access mask of the mode
+      std::unordered_map<uint32_t, component_map_t> components;
     };
   }
 }
@@ -1,8 +1,12 @@
 #ifndef VALHALLA_BALDR_DATETIME_H_
 #define VALHALLA_BALDR_DATETIME_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/local_time/tz_database.hpp>
@@ -14,12 +18,92 @@ namespace valhalla {
 namespace baldr {
 namespace DateTime {
 
+  /**
+   * The UTC offsets of a time zone as a sorted table of the instants they
+   * change, from kMinOffsetYear through kMaxOffsetYear. Converting between
+   * UTC and local seconds since epoch is then a binary search and an add.
+   * Times which are skipped or repeated when the clocks change resolve to the
+   * offset from before the change, the same as get_ldt.
+   */
+  constexpr int kMinOffsetYear = 1970;
+  constexpr int kMaxOffsetYear = 2100;
+  struct tz_offsets_t {
+    struct entry_t {
+      int64_t utc;     // when the offset starts, in UTC seconds since epoch
+      int64_t local;   // when local times start using it, in local seconds
+      int32_t offset;  // seconds east of UTC
+      bool dst;        // whether it is daylight savings time
+    };
+    std::vector<entry_t> entries;
+
+    /**
+     * Whether the table is accurate at a time, it is within the years
+     * covered. The same for UTC and local seconds.
+     * @param  seconds  seconds since epoch
+     */
+    static bool covers(int64_t seconds);
+
+    /**
+     * Get the entry in effect at a UTC time.
+     * @param  utc  UTC seconds since epoch
+     */
+    const entry_t& at_utc(int64_t utc) const {
+      return *(std::upper_bound(entries.cbegin() + 1, entries.cend(), utc,
+        [](int64_t t, const entry_t& e) { return t < e.utc; }) - 1);
+    }
+
+    /**
+     * Get the entry in effect at a local time.
+     * @param  local  local seconds since epoch
+     */
+    const entry_t& at_local(int64_t local) const {
+      return *(std::upper_bound(entries.cbegin() + 1, entries.cend(), local,
+        [](int64_t t, const entry_t& e) { return t < e.local; }) - 1);
+    }
+
+    int64_t to_local(int64_t utc) const { return utc + at_utc(utc).offset; }
+    int64_t to_utc(int64_t local) const { return local - at_local(local).offset; }
+  };
+
   struct tz_db_t : public boost::local_time::tz_database {
     tz_db_t();
+    /**
+     * Get the index of a region, as stored in NodeInfo::timezone().
+     * @param  region  name of the region, ie. America/New_York
+     * @return the index or 0 if there is no such region
+     */
     size_t to_index(const std::string& region) const;
-    boost::shared_ptr<time_zone_base_type> from_index(size_t index) const;
+    /**
+     * Get the time zone at an index. The zones are looked up once when the
+     * database is loaded so this is an array access.
+     * @param  index  index of the region
+     * @return the time zone, empty if the index is 0 or out of range
+     */
+    const boost::shared_ptr<time_zone_base_type>& from_index(size_t index) const;
+    /**
+     * Get the index of a time zone which came from this database.
+     * @param  time_zone  the time zone
+     * @return the index or 0 if it is not from this database
+     */
+    size_t zone_index(const boost::shared_ptr<time_zone_base_type>& time_zone) const;
+    /**
+     * Get the UTC offsets of the time zone at an index. Each zone's table is
+     * built the first time it is asked for, safely from any thread.
+     * @param  index  index of the region
+     * @return the offsets, always 0 for index 0 or one out of range
+     */
+    const tz_offsets_t& offsets_from_index(size_t index) const;
    protected:
     std::vector<std::string> regions;
+    //index of each region
+    std::unordered_map<std::string, size_t> region_indices;
+    //time zone of each index, the empty zone at 0
+    std::vector<boost::shared_ptr<time_zone_base_type> > zones;
+    //index of each time zone
+    std::unordered_map<const time_zone_base_type*, size_t> zone_indices;
+    //utc offsets of each index, built on first use
+    mutable std::vector<tz_offsets_t> offsets;
+    mutable std::vector<std::once_flag> offsets_built;
   };
 
   /**
@@ -34,6 +118,31 @@ namespace DateTime {
    */
   std::string get_testing_date_time();
 
+  /**
+   * The fields of a date and or time string, see parse_date_time.
+   */
+  struct date_time_fields_t {
+    int32_t year;
+    int32_t month;
+    int32_t day;
+    int32_t hour;
+    int32_t minute;
+    int32_t second;
+    bool has_date;
+    bool has_time;
+  };
+
+  /**
+   * Parse a date and or time into its fields in one pass, without allocating.
+   * Accepts 20150516, 2015-05-16, either followed by T08:00 or T08:00:00, and
+   * just a time of 08:00 or 08:00:00. Hours can be greater than 24, nothing
+   * else is range checked.
+   * @param   date_time  the string to parse
+   * @param   fields     the parsed fields, missing ones are 0
+   * @return  Returns false if the string is not in one of those formats.
+   */
+  bool parse_date_time(const std::string& date_time, date_time_fields_t& fields);
+
   /**
    * Get a formatted date from a string.
    * @param date in the format of 20150516 or 2015-05-06T08:00
@@ -98,6 +207,43 @@ namespace DateTime {
   bool is_service_available(const uint64_t days, const uint32_t start_date,
                             const uint32_t date, const uint32_t end_date);
 
+  /**
+   * Days a transit service runs, like get_service_days, but as days since
+   * the pivot date. Works on the masks directly rather than iterating the
+   * days: the day of week mask is rotated to start on the tile date's day,
+   * repeated over the 60 days and cut to the service's date range.
+   */
+  struct service_range_t {
+    int32_t start_date;   // days since pivot, may be before it
+    int32_t end_date;     // days since pivot, inclusive
+    uint32_t dow_mask;    // days of the week the service runs
+  };
+
+  /**
+   * Get the days that this transit service is running in 60 days or less,
+   * bit 0 being the tile date.
+   * @param   service   date range and days of the week of the service
+   * @param   tile_date days since pivot
+   * @return  Returns the service days.
+   */
+  uint64_t get_service_days(const service_range_t& service, const uint32_t tile_date);
+
+  /**
+   * Get the service days of many services at once.
+   * @param   services  date ranges and days of the week of the services
+   * @param   tile_date days since pivot
+   * @param   days      filled with the service days of each service
+   */
+  void get_service_days(const std::vector<service_range_t>& services, const uint32_t tile_date,
+                        std::vector<uint64_t>& days);
+
+  /**
+   * Get the day of the week of a day since pivot.
+   * @param   date  days since pivot
+   * @return  Returns the day of the week, 0 for Sunday to 6 for Saturday.
+   */
+  uint32_t day_of_week(const int32_t date);
+
   /**
    * Get the number of days elapsed from the pivot date until
    * inputed date.
@@ -141,7 +287,8 @@ namespace DateTime {
   uint64_t seconds_since_epoch(const std::string& date_time, const boost::local_time::time_zone_ptr& time_zone);
 
   /**
-   * Get the iso date time from seconds since epoch and timezone.
+   * Get the iso date time from seconds since epoch and timezone. The local
+   * times come from the UTC offset tables when they cover them.
    * @param   origin_seconds      seconds since epoch for origin
    * @param   dest_seconds        seconds since epoch for dest
    * @param   origin_tz           timezone for origin
@@ -970,6 +970,12 @@ class DirectedEdge {
    */
   json::MapPtr json() const;
 
+  /**
+   * Write a json object representing this edge without building it first
+   * @param  writer  the writer to write to
+   */
+  void json(json::StreamWriter& writer) const;
+
  protected:
 
   uint64_t endnode_             : 46; // End node of the directed edge
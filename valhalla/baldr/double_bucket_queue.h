@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_DOUBLE_BUCKET_QUEUE_H_
 #define VALHALLA_BALDR_DOUBLE_BUCKET_QUEUE_H_
 
+#include <algorithm>
 #include <vector>
 #include <deque>
 #include <valhalla/midgard/util.h>
@@ -15,6 +16,26 @@ constexpr uint32_t kInvalidLabel = std::numeric_limits<uint32_t>::max();
  */
 using LabelCost = std::function<float (const uint32_t label)>;
 
+// Most low level buckets an adaptive queue will allocate
+constexpr uint32_t kMaxAdaptiveBuckets = 32768;
+
+/**
+ * Statistics kept by a DoubleBucketQueue, accumulated over all queries
+ * since construction or the last reset_stats(). Useful to pick the range
+ * and bucket size for a costing model.
+ */
+struct BucketQueueStats {
+  uint64_t adds;            // Labels added
+  uint64_t decreases;       // Calls to decrease
+  uint64_t pops;            // Labels popped
+  uint64_t stale;           // Stale labels skipped (lazy decrease)
+  uint64_t overflow_adds;   // Labels added to the overflow bucket
+  uint64_t overflow_scans;  // Labels examined when emptying the overflow
+  uint64_t range_shifts;    // Moves of the low level buckets to higher costs
+  uint64_t resizes;         // Changes of range or bucket size (adaptive)
+  float maxcost;            // Highest cost of a bucket popped from
+};
+
 /**
  * Double Bucket Queue. Contains a bucket sort implementation for performance.
  * An "overflow" bucket is maintained to allow reduced memory use. Costs
@@ -34,9 +55,23 @@ class DoubleBucketQueue {
    * @param bucketsize Bucket size (range of costs within same bucket).
    *                   Must be an integer value.
    * @param labelcost  Functor to get a cost given a label index.
+   * @param lazydecrease  If true decrease is O(1): the label is added to
+   *                   its new bucket and the stale entry in its previous
+   *                   bucket is skipped when popped. This keeps track of
+   *                   the bucket of each label, so labels should be dense
+   *                   indexes.
+   * @param maxbucketsize  If non zero the queue adapts its layout. During a
+   *                   query the range doubles (up to kMaxAdaptiveBuckets
+   *                   buckets) each time the overflow bucket is emptied.
+   *                   On clear the range is sized to cover the costs popped
+   *                   in the last query, doubling the bucket size (up to
+   *                   maxbucketsize) if that takes too many buckets. Use
+   *                   bucketsize to only adapt the range.
    */
   DoubleBucketQueue(const float mincost, const float range,
-                    const uint32_t bucketsize, const LabelCost& labelcost);
+                    const uint32_t bucketsize, const LabelCost& labelcost,
+                    const bool lazydecrease = false,
+                    const uint32_t maxbucketsize = 0);
 
   /**
    * Destructor.
@@ -45,9 +80,40 @@ class DoubleBucketQueue {
 
   /**
    * Clear all labels from the low-level buckets and the overflow buckets.
+   * The cost range starts over at the minimum cost. An adaptive queue
+   * resizes its range and bucket size for the next query.
    */
   void clear();
 
+  /**
+   * Get the statistics accumulated since construction or the last reset.
+   * @return  Returns the statistics.
+   */
+  const BucketQueueStats& stats() const {
+    return stats_;
+  }
+
+  /**
+   * Reset the statistics.
+   */
+  void reset_stats();
+
+  /**
+   * Get the current cost range of the low level buckets.
+   * @return  Returns the cost range.
+   */
+  float range() const {
+    return bucketrange_;
+  }
+
+  /**
+   * Get the current bucket size.
+   * @return  Returns the bucket size.
+   */
+  float bucketsize() const {
+    return bucketsize_;
+  }
+
   /**
    * Adds a label index to the bucketed sort. Adds it to the appropriate bucket
    * given the cost. If the cost is greater than maxcost_ the label
@@ -57,7 +123,13 @@ class DoubleBucketQueue {
    * @param   cost   Cost for this label.
    */
   void add(const uint32_t label, const float cost) {
-    get_bucket(cost).push_back(label);
+    uint32_t idx = bucket_index(cost);
+    get_bucket(idx).push_back(label);
+    if (lazydecrease_) {
+      track(label, idx);
+    }
+    stats_.adds++;
+    stats_.overflow_adds += (idx == buckets_.size());
   }
 
   /**
@@ -79,12 +151,22 @@ class DoubleBucketQueue {
 
  private:
   float bucketrange_;  // Total range of costs in lower level buckets
-  float bucketcount_;  // Number of buckets
   float bucketsize_;   // Bucket size (range of costs in same bucket)
   float inv_;          // 1/bucketsize (so we can avoid division)
+  float startcost_;    // Minimum cost given to the constructor
   float mincost_;      // Minimum cost within the low level buckets
   float maxcost_;      // Above this goes into overflow bucket
   float currentcost_;  // Current cost
+  float querycost_;    // Highest cost popped since the last clear
+  bool lazydecrease_;  // Skip stale labels on pop rather than erase them
+
+  // Initial range and bucket size, and the largest bucket size an adaptive
+  // queue may use (0 if not adaptive)
+  float initialrange_;
+  uint32_t initialsize_;
+  uint32_t maxbucketsize_;
+
+  BucketQueueStats stats_;
 
   // Low level buckets
   std::vector<std::deque<uint32_t>> buckets_;
@@ -98,18 +180,82 @@ class DoubleBucketQueue {
   // Cost function to get cost given the label index.
   LabelCost labelcost_;
 
+  // Bucket index each label is currently queued in (lazy decrease only).
+  // The overflow bucket has index buckets_.size(), labels not in the
+  // queue have kInvalidLabel.
+  std::vector<uint32_t> label_buckets_;
+
   /**
-   * Returns the bucket given the cost.
+   * Returns the index of the bucket given the cost. The overflow bucket
+   * has index buckets_.size().
    * @param  cost  Cost.
-   * @return Returns the bucket that the cost lies within.
+   * @return Returns the index of the bucket that the cost lies within.
    */
-  std::deque<uint32_t>& get_bucket(const float cost) {
-    return (cost < currentcost_) ? *currentbucket_ :
+  uint32_t bucket_index(const float cost) const {
+    return (cost < currentcost_) ? currentbucket_ - buckets_.begin() :
              (cost < maxcost_) ?
-               buckets_[static_cast<uint32_t>((cost - mincost_) * inv_)] :
-               overflowbucket_;
+               static_cast<uint32_t>((cost - mincost_) * inv_) :
+               buckets_.size();
+  }
+
+  /**
+   * Returns the bucket given its index.
+   * @param  idx  Bucket index.
+   * @return Returns the bucket.
+   */
+  std::deque<uint32_t>& get_bucket(const uint32_t idx) {
+    return (idx < buckets_.size()) ? buckets_[idx] : overflowbucket_;
+  }
+
+  /**
+   * Records the bucket a label is queued in.
+   * @param  label  Label index.
+   * @param  idx    Bucket index.
+   */
+  void track(const uint32_t label, const uint32_t idx) {
+    if (label >= label_buckets_.size()) {
+      label_buckets_.resize(label + 1, kInvalidLabel);
+    }
+    label_buckets_[label] = idx;
+  }
+
+  /**
+   * Sets the cost range of the low level buckets to start at the minimum
+   * cost and allocates the buckets to cover it.
+   */
+  void reset_range();
+
+  /**
+   * Resizes the low level buckets to cover mincost_ to maxcost_. Must only
+   * be called when the low level buckets are empty.
+   */
+  void resize_buckets();
+
+  /**
+   * Picks the range and bucket size for the next query from the costs
+   * popped in the last one (adaptive only).
+   */
+  void adapt();
+
+  /**
+   * Records a popped label in the statistics.
+   * @param  label  Label index.
+   * @return Returns the label index.
+   */
+  uint32_t popped(const uint32_t label) {
+    stats_.pops++;
+    querycost_ = std::max(querycost_, currentcost_);
+    stats_.maxcost = std::max(stats_.maxcost, currentcost_);
+    return label;
   }
 
+  /**
+   * Removes the lowest cost label index from the low level buckets.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the low level buckets are empty.
+   */
+  uint32_t pop_bucket();
+
   /**
    * Empties the overflow bucket by placing the label indexes into the
    * low level buckets.
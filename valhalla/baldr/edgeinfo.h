@@ -5,6 +5,8 @@
 #include <string>
 #include <ostream>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
 
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/shape_decoder.h>
@@ -20,6 +22,85 @@ namespace baldr {
 constexpr size_t kMaxNamesPerEdge = 15;
 constexpr size_t kMaxEncodedShapeSize = 65535;
 
+// Maximum number of decoded shapes kept per tile before the cache is flushed
+constexpr size_t kMaxCachedShapes = 1024;
+
+/**
+ * Decodes a 7 bit varint encoded shape (as stored in the edge info) into
+ * a list of lng, lat points. The number of points is counted up front,
+ * several bytes at a time, so that the output is allocated exactly once and
+ * the decode loop itself does not need any bounds checks.
+ * @param  encoded  Pointer to the encoded shape.
+ * @param  size     Size (bytes) of the encoded shape.
+ * @return Returns the decoded shape.
+ */
+std::vector<PointLL> decode_shape7(const char* encoded, const size_t size);
+
+/**
+ * A bounded cache of decoded edge shapes keyed by the offset of the edge
+ * info within its tile. Shapes are handed out as shared pointers so they
+ * stay valid for their users even when the cache gets flushed. Like the
+ * GraphReader that holds the tiles it is NOT thread-safe!
+ */
+class ShapeCache {
+ public:
+  using shape_ptr = std::shared_ptr<const std::vector<PointLL> >;
+
+  /**
+   * Constructor
+   * @param  max_size  Maximum number of shapes to keep before flushing.
+   */
+  ShapeCache(const size_t max_size = kMaxCachedShapes);
+
+  /**
+   * Get the decoded shape for an edge info, decoding it if it is not
+   * cached yet.
+   * @param  offset   Offset of the edge info within the tile.
+   * @param  encoded  Pointer to the encoded shape.
+   * @param  size     Size (bytes) of the encoded shape.
+   * @return Returns the decoded shape.
+   */
+  shape_ptr get(const uint32_t offset, const char* encoded, const size_t size);
+
+  /**
+   * Clears the cache
+   */
+  void clear();
+
+  /**
+   * Get the number of cached shapes.
+   * @return Returns the number of cached shapes.
+   */
+  size_t size() const;
+
+  /**
+   * Get the memory used by the cached shapes.
+   * @return Returns the size (bytes) of the cached shapes' points.
+   */
+  size_t memory() const;
+
+  /**
+   * Keep a running total up to date with the memory used by the cached
+   * shapes, as they are decoded and flushed. The memory already used moves
+   * from any previous total to the new one.
+   * @param  total  Running total (bytes) shared with other caches.
+   */
+  void report_to(const std::shared_ptr<size_t>& total);
+
+ protected:
+  // Max number of shapes before the cache is flushed
+  size_t max_size_;
+
+  // Bytes of points held by the cached shapes
+  size_t memory_;
+
+  // Running total the memory is reported to (may be null)
+  std::shared_ptr<size_t> total_;
+
+  // Decoded shapes keyed by edge info offset
+  std::unordered_map<uint32_t, shape_ptr> shapes_;
+};
+
 // Name information. Information about names added to the names list within
 // the tile. A name can have a textual representation followed by optional
 // fields that provide additional information about the name.
@@ -61,6 +142,18 @@ class EdgeInfo {
    */
   EdgeInfo(char* ptr, const char* names_list, const size_t names_list_length);
 
+  /**
+   * Constructor which shares decoded shapes through a cache. Like the rest
+   * of the tile's memory the cache must outlive the edge info.
+   * @param  ptr  Pointer to a bit of memory that has the info for this edge
+   * @param  names_list  Pointer to the start of the text/names list.
+   * @param  names_list_length  Length (bytes) of the text/names list.
+   * @param  shape_cache  Cache of decoded shapes for the tile (may be null).
+   * @param  offset  Offset of this edge info within the tile.
+   */
+  EdgeInfo(char* ptr, const char* names_list, const size_t names_list_length,
+           ShapeCache* shape_cache, const uint32_t offset);
+
   /**
    * Destructor
    */
@@ -127,6 +220,12 @@ class EdgeInfo {
    */
   json::MapPtr json() const;
 
+  /**
+   * Writes json representing this object without building it first
+   * @param writer the writer to write to
+   */
+  void json(json::StreamWriter& writer) const;
+
   // Operator EqualTo based on nodea and nodeb.
   bool operator ==(const EdgeInfo& rhs) const;
 
@@ -159,6 +258,14 @@ class EdgeInfo {
   // The size of the names list
   size_t names_list_length_;
 
+  // Shape of the edge when it comes from the tile's shape cache
+  mutable ShapeCache::shape_ptr cached_shape_;
+
+  // Where decoded shapes are shared (may be null) and our key into it, the
+  // tile owns the cache
+  ShapeCache* shape_cache_;
+  uint32_t offset_;
+
 };
 
 }
@@ -117,6 +117,12 @@ union GraphId {
    */
   json::Value json() const;
 
+  /**
+   * Writes the json representation of the id
+   * @param  writer  the writer to write to
+   */
+  void json(json::StreamWriter& writer) const;
+
   /**
    * Post increments the id.
    */
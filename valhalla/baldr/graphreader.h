@@ -64,7 +64,8 @@ class GraphReader {
   void Clear();
 
   /**
-   * Lets you know if the cache is too large
+   * Lets you know if the cache is too large, counting the shapes the tiles
+   * have decoded as well as the tiles themselves
    * @return true if the cache is over committed with respect to the limit
    */
   bool OverCommitted() const;
@@ -128,6 +129,9 @@ class GraphReader {
   // The current cache size in bytes
   size_t cache_size_;
 
+  // The bytes of shapes decoded by the cached tiles, kept up to date by them
+  std::shared_ptr<size_t> decoded_shapes_size_;
+
   // The max cache size in bytes
   size_t max_cache_size_;
 };
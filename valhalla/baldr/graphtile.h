@@ -21,7 +21,10 @@
 #include <valhalla/midgard/util.h>
 
 #include <boost/shared_array.hpp>
+#include <cstddef>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include "signinfo.h"
 
 namespace valhalla {
@@ -29,6 +32,90 @@ namespace baldr {
 
 using tile_index_pair = std::pair<uint32_t, uint32_t>;
 
+/**
+ * An entry in the per tile way Id index. Sorted by way Id, then edge info
+ * offset (both directions of an edge share it) and then edge index.
+ */
+struct WayEdge {
+  uint64_t wayid;
+  uint32_t edgeinfo_offset;
+  uint32_t edgeid;
+
+  bool operator < (const WayEdge& other) const {
+    if (wayid == other.wayid) {
+      if (edgeinfo_offset == other.edgeinfo_offset)
+        return edgeid < other.edgeid;
+      return edgeinfo_offset < other.edgeinfo_offset;
+    }
+    return wayid < other.wayid;
+  }
+};
+
+/**
+ * A range over the directed edges leaving a node which can be used in range
+ * based for loops. Dereferencing an iterator gives the GraphId of the edge
+ * along with a pointer to it, for example:
+ *
+ *     for (const auto& edge : tile->edges(node_id)) {
+ *       if (edge.second->endnode() == other)
+ *         return edge.first;
+ *     }
+ *
+ * The bounds are checked once when the range is made, so iterating is just
+ * a pointer increment and the GraphId is computed from the pointer offset.
+ */
+class DirectedEdgeRange {
+ public:
+  using value_type = std::pair<GraphId, const DirectedEdge*>;
+
+  // Dereferencing yields the pair by value rather than a reference into the
+  // tile, so this only claims to be an input iterator. Offsetting and
+  // differencing are still cheap and are provided for indexing and size().
+  class const_iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = DirectedEdgeRange::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = value_type;
+
+    const_iterator(const DirectedEdge* ptr, const DirectedEdge* first,
+                   const GraphId& first_id)
+      : ptr_(ptr), first_(first), first_id_(first_id) {}
+
+    value_type operator*() const {
+      return value_type(first_id_ + static_cast<uint64_t>(ptr_ - first_), ptr_);
+    }
+    const_iterator& operator++() { ++ptr_; return *this; }
+    const_iterator operator++(int) { const_iterator ret = *this; ++ptr_; return ret; }
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(ptr_ + n, first_, first_id_);
+    }
+    difference_type operator-(const const_iterator& other) const {
+      return ptr_ - other.ptr_;
+    }
+    bool operator==(const const_iterator& other) const { return ptr_ == other.ptr_; }
+    bool operator!=(const const_iterator& other) const { return ptr_ != other.ptr_; }
+
+   private:
+    const DirectedEdge* ptr_;
+    const DirectedEdge* first_;
+    GraphId first_id_;
+  };
+
+  DirectedEdgeRange(const DirectedEdge* first, const uint32_t count,
+                    const GraphId& first_id)
+    : begin_(first, first, first_id), end_(first + count, first, first_id) {}
+
+  const_iterator begin() const { return begin_; }
+  const_iterator end() const { return end_; }
+  size_t size() const { return end_ - begin_; }
+  bool empty() const { return begin_ == end_; }
+
+ private:
+  const_iterator begin_, end_;
+};
+
 /**
  * Graph information for a tile within the Tiled Hierarchical Graph.
  */
@@ -129,11 +216,27 @@ class GraphTile {
   GraphId GetOpposingEdgeId(const DirectedEdge* edge) const;
 
   /**
-   * Get a pointer to edge info.
+   * Get a pointer to edge info. Decoded shapes are shared through the
+   * tile's shape cache so repeated lookups of the same edge info don't
+   * decode its shape again. The edge info must not outlive the tile.
    * @return  Returns edge info.
    */
   EdgeInfo edgeinfo(const size_t offset) const;
 
+  /**
+   * Get the memory used by the shapes decoded so far, which is held on top
+   * of the tile itself (at most kMaxCachedShapes of them).
+   * @return  Returns the size (bytes) of the decoded shapes.
+   */
+  size_t decoded_shapes_size() const;
+
+  /**
+   * Add the memory used by the shapes this tile decodes to a running total,
+   * so the total can be checked without visiting every tile.
+   * @param  total  Running total (bytes) of decoded shapes.
+   */
+  void track_decoded_shapes(const std::shared_ptr<size_t>& total) const;
+
   /**
    * Get the complex restrictions in the forward or reverse order.
    * @param   forward - do we want the restrictions in reverse order?
@@ -146,12 +249,27 @@ class GraphTile {
                                                   const GraphId id,
                                                   const uint64_t modes) const;
 
+  /**
+   * Get the directed edges originating at a node as an iterable range.
+   * @param  node  GraphId of the node, must be within this tile.
+   * @return  Returns the range of (GraphId, DirectedEdge*) pairs.
+   */
+  DirectedEdgeRange edges(const GraphId& node) const;
+
+  /**
+   * Get the directed edges originating at a node as an iterable range.
+   * @param  node_index  Index of the node within this tile.
+   * @return  Returns the range of (GraphId, DirectedEdge*) pairs.
+   */
+  DirectedEdgeRange edges(const size_t node_index) const;
+
   /**
    * Convenience method to get the directed edges originating at a node.
    * @param  node_index  Node Id within this tile.
    * @param  count       (OUT) Number of outbound edges
    * @param  edge_index  (OUT) Index of the first outbound edge.
-   * @return  Returns a pointer to the first outbound directed edge.
+   * @return  Returns a pointer to the first outbound directed edge, which
+   *          must not be dereferenced if count is 0.
    */
   const DirectedEdge* GetDirectedEdges(const uint32_t node_index,
                                        uint32_t& count, uint32_t& edge_index) const;
@@ -164,6 +282,22 @@ class GraphTile {
    */
   std::vector<std::string> GetNames(const uint32_t edgeinfo_offset) const;
 
+  /**
+   * Get the directed edges within this tile that lie on the given OSM way.
+   * Shortcuts, transitions and transit lines are not included. The way Id
+   * index is built the first time it is needed and then shared between
+   * copies of the tile.
+   * @param  wayid  OSM way Id.
+   * @return  Returns the graph Ids of the directed edges on the way.
+   */
+  std::vector<GraphId> GetEdgesForWay(const uint64_t wayid) const;
+
+  /**
+   * Get the OSM way Ids (sorted, no duplicates) that have edges in this tile.
+   * @return  Returns the way Ids.
+   */
+  std::vector<uint64_t> GetWayIds() const;
+
   /**
    * Get the admininfo at the specified index. Populates the state name and
    * country name from the text/name list.
@@ -206,7 +340,10 @@ class GraphTile {
    * @param   wheelchair        Only find departures with wheelchair access if true
    * @param   bicyle            Only find departures with bicycle access if true
    * @return  Returns a pointer to the transit departure information.
-   *          Returns nullptr if no departures are found.
+   *          Returns nullptr if no departures are found. A frequency based
+   *          departure may have started before current_time, use the
+   *          overload returning the departure time to find when it next
+   *          departs.
    */
   const TransitDeparture* GetNextDeparture(const uint32_t lineid,
                                            const uint32_t current_time,
@@ -216,6 +353,94 @@ class GraphTile {
                                            bool wheelchair,
                                            bool bicycle) const;
 
+  /**
+   * Get the next departure given the directed edge Id and the current
+   * time (seconds from midnight), along with its departure time. Fixed
+   * and frequency based departures are both considered.
+   * @param   lineid            Transit Line Id
+   * @param   current_time      Current time (seconds from midnight).
+   * @param   day               Days since the tile creation date.
+   * @param   dow               Day of week (see graphconstants.h)
+   * @param   date_before_tile  Is the date that was inputed before
+   *                            the tile creation date?
+   * @param   wheelchair        Only find departures with wheelchair access if true
+   * @param   bicyle            Only find departures with bicycle access if true
+   * @param   departure_time    Set to the time of the departure (seconds
+   *                            from midnight) or kInvalidDepartureTime.
+   * @return  Returns a pointer to the transit departure information.
+   *          Returns nullptr if no departures are found.
+   */
+  const TransitDeparture* GetNextDeparture(const uint32_t lineid,
+                                           const uint32_t current_time,
+                                           const uint32_t day,
+                                           const uint32_t dow,
+                                           bool  date_before_tile,
+                                           bool wheelchair,
+                                           bool bicycle,
+                                           uint32_t& departure_time) const;
+
+  /**
+   * Get all the departures of a transit line. Departures of a line are
+   * contiguous and sorted by departure time.
+   * @param   lineid  Transit Line Id
+   * @return  Returns an iterable range of departures (empty if the line
+   *          has no departures in this tile).
+   */
+  midgard::iterable_t<const TransitDeparture> GetDepartures(const uint32_t lineid) const;
+
+  /**
+   * Get all valid departures of a transit line within a time window.
+   * @param   lineid            Transit Line Id
+   * @param   start_time        Start of the window (seconds from midnight).
+   * @param   end_time          End of the window, inclusive (seconds from midnight).
+   * @param   day               Days since the tile creation date.
+   * @param   dow               Day of week (see graphconstants.h)
+   * @param   date_before_tile  Is the date that was inputed before
+   *                            the tile creation date?
+   * @param   wheelchair        Only find departures with wheelchair access if true
+   * @param   bicyle            Only find departures with bicycle access if true
+   * @return  Returns the valid departures sorted by departure time. A
+   *          frequency based departure is included once if any of its
+   *          departures fall within the window.
+   */
+  std::vector<const TransitDeparture*> GetDeparturesInWindow(const uint32_t lineid,
+                                                             const uint32_t start_time,
+                                                             const uint32_t end_time,
+                                                             const uint32_t day,
+                                                             const uint32_t dow,
+                                                             bool date_before_tile,
+                                                             bool wheelchair,
+                                                             bool bicycle) const;
+
+  /**
+   * Get which transit schedules of the tile are valid on a day, all at once.
+   * Departures can then be checked by their schedule index rather than
+   * looking up and checking each one's schedule, see FilterDepartures.
+   * @param   day               Days since the tile creation date.
+   * @param   dow               Day of week (see graphconstants.h)
+   * @param   date_before_tile  Is the date that was inputed before
+   *                            the tile creation date?
+   * @param   valid             Set to 1 for each valid schedule index, 0
+   *                            otherwise.
+   */
+  void GetValidSchedules(const uint32_t day, const uint32_t dow,
+                         bool date_before_tile, std::vector<uint8_t>& valid) const;
+
+  /**
+   * Get the valid departures of a range of departures, for example all
+   * the departures of a line from GetDepartures.
+   * @param   departures        Range of departures to filter.
+   * @param   valid_schedules   Valid schedules from GetValidSchedules.
+   * @param   wheelchair        Only keep departures with wheelchair access if true
+   * @param   bicyle            Only keep departures with bicycle access if true
+   * @param   found             Valid departures are appended, in the order
+   *                            of the range.
+   */
+  static void FilterDepartures(midgard::iterable_t<const TransitDeparture> departures,
+                               const std::vector<uint8_t>& valid_schedules,
+                               bool wheelchair, bool bicycle,
+                               std::vector<const TransitDeparture*>& found);
+
   /**
    * Get the departure given the directed edge Id and tripid
    * @param   lineid  Transit Line Id
@@ -332,6 +557,17 @@ class GraphTile {
   // sorted by departure time)
   TransitDeparture* departures_;
 
+  // Range [begin, end) of departures for a transit line and whether any of
+  // them are frequency based
+  struct LineDepartures {
+    uint32_t begin;
+    uint32_t end;
+    bool frequency;
+  };
+
+  // Departure ranges for each transit line, indexed by line Id
+  std::vector<LineDepartures> line_departures_;
+
   // Transit stops (indexed by stop index within the tile)
   TransitStop* transit_stops_;
 
@@ -380,6 +616,18 @@ class GraphTile {
   // Number of bytes in the text/name list
   std::size_t textlist_size_;
 
+  // Decoded edge shapes keyed by edgeinfo offset. Shared between copies of
+  // the tile since they all point at the same memory.
+  std::shared_ptr<ShapeCache> shape_cache_;
+
+  // Way Id index (sorted), built lazily. The index can be empty once built
+  // so it keeps a flag of its own, both shared between copies of the tile.
+  struct way_index_t {
+    std::once_flag built;
+    std::vector<WayEdge> edges;
+  };
+  std::shared_ptr<way_index_t> way_edges_;
+
   // List of edge graph ids. The list is broken up in bins which have
   // indices in the tile header.
   GraphId* edge_bins_;
@@ -413,6 +661,28 @@ class GraphTile {
                   const size_t tile_size);
 
   void AssociateOneStopIds(const GraphId& graphid);
+
+  /**
+   * Build the index of departure ranges per transit line.
+   */
+  void IndexDepartures();
+
+  /**
+   * Get the first departure of a line that can depart at or after the
+   * given time. Frequency based departures can depart after their start
+   * time so lines having them are searched from their first departure.
+   * @param   lineid        Transit Line Id
+   * @param   current_time  Time (seconds from midnight).
+   * @return  Returns a pointer to the first departure to consider.
+   */
+  const TransitDeparture* LowerBound(const uint32_t lineid,
+                                     const uint32_t current_time) const;
+
+  /**
+   * Get the way Id index, building it if it has not been built yet.
+   * @return  Returns the sorted way Id index.
+   */
+  const std::vector<WayEdge>& way_edges() const;
 };
 
 }
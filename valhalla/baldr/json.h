@@ -2,13 +2,20 @@
 #define VALHALLA_BALDR_JSON_H_
 
 #include <ostream>
+#include <algorithm>
 #include <boost/variant.hpp>
 #include <memory>
 #include <string>
 #include <cinttypes>
+#include <cmath>
 #include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <unordered_map>
 #include <list>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 
@@ -28,6 +35,75 @@ struct fp_t {
   friend std::ostream& operator<<(std::ostream& stream, const fp_t&);
 };
 
+//an fp_t precision asking for the fewest significant digits which read back
+//as the same double, rather than a fixed number of decimals
+constexpr size_t kShortest = std::numeric_limits<size_t>::max();
+
+/**
+ * Writes an fp_t as text, the same as std::fixed with its precision would but
+ * without going through iostreams or the locale. Values which fit scale to an
+ * integer which is rounded to nearest and printed digit by digit. Anything
+ * else, including values which scale to within an ulp of a half where the
+ * rounding of the scaling itself could pick the wrong side, goes through
+ * snprintf. kShortest writes the shortest text which reads
+ * back as the same double (possibly with an exponent).
+ * @param fp      the value to write
+ * @param buffer  where to write it, it may not be null terminated
+ * @param size    room in the buffer, 64 is plenty for any coordinate
+ * @return the length of the text, if not less than size it did not fit and
+ *         a buffer with more room is needed
+ */
+inline size_t to_chars(const fp_t& fp, char* buffer, size_t size) {
+  static const long double powers[] = {1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L,
+    1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L,
+    1e17L, 1e18L};
+  //the quick way, scale to an integer and print its digits
+  if(fp.precision < sizeof(powers) / sizeof(powers[0]) && std::isfinite(fp.value)) {
+    long double scaled = std::fabs(fp.value) * powers[fp.precision];
+    //scaling can round by an ulp, so which way a value within that of a half
+    //should go is only known from its exact digits, leave those to snprintf
+    long double fraction = scaled - std::floor(scaled);
+    if(scaled < 9e18L &&
+       std::fabs(fraction - 0.5L) > scaled * std::numeric_limits<long double>::epsilon()) {
+      uint64_t integer = std::llrint(scaled);
+      char digits[24];
+      char* end = digits + sizeof(digits);
+      char* begin = end;
+      for(size_t i = 0; i < fp.precision; ++i, integer /= 10)
+        *--begin = '0' + integer % 10;
+      if(fp.precision)
+        *--begin = '.';
+      do {
+        *--begin = '0' + integer % 10;
+        integer /= 10;
+      } while(integer);
+      if(std::signbit(fp.value))
+        *--begin = '-';
+      size_t length = end - begin;
+      if(length < size)
+        std::memcpy(buffer, begin, length);
+      return length;
+    }
+  }
+
+  //huge, tiny or shortest values
+  int length;
+  if(fp.precision == kShortest) {
+    double value = static_cast<double>(fp.value);
+    for(int precision = 15; precision <= 17; ++precision) {
+      length = std::snprintf(buffer, size, "%.*g", precision, value);
+      if(length >= static_cast<int>(size) || std::strtod(buffer, nullptr) == value)
+        break;
+    }
+  }
+  else
+    length = std::snprintf(buffer, size, "%.*Lf", static_cast<int>(fp.precision), fp.value);
+  //undo the locale's decimal point
+  if(length < static_cast<int>(size))
+    std::replace(buffer, buffer + length, ',', '.');
+  return length;
+}
+
 //a variant of all the possible values to go with keys in json
 using Value = boost::variant<std::string, uint64_t, int64_t, fp_t, bool, std::nullptr_t, MapPtr, ArrayPtr>;
 
@@ -91,8 +167,13 @@ class OstreamVisitor : public boost::static_visitor<std::ostream&>
 };
 
 inline std::ostream& operator<<(std::ostream& stream, const fp_t& fp){
-  stream << std::setprecision(fp.precision) << std::fixed << fp.value;
-  return stream;
+  char digits[64];
+  size_t length = to_chars(fp, digits, sizeof(digits));
+  if(length < sizeof(digits))
+    return stream.write(digits, length);
+  std::vector<char> more(length + 1);
+  to_chars(fp, more.data(), more.size());
+  return stream.write(more.data(), length);
 }
 
 inline std::ostream& operator<<(std::ostream& stream, const Jmap& json){
@@ -122,6 +203,186 @@ inline std::ostream& operator<<(std::ostream& stream, const Jarray& json){
   return stream;
 }
 
+/**
+ * Writes json straight into a growable buffer as it is described, rather than
+ * building a tree of maps and arrays to serialize afterwards. Strings, and
+ * keys, are escaped the same way as OstreamVisitor. Nothing checks that keys
+ * and values come in a valid order.
+ *
+ *   json::StreamWriter writer;
+ *   writer.start_map();
+ *   writer("way_id", uint64_t(7));
+ *   writer.key("names").start_array().value("Main Street").end_array();
+ *   writer.end_map();
+ *   std::cout << writer;
+ */
+class StreamWriter {
+ public:
+  explicit StreamWriter(size_t capacity = 4096) : after_key_(false) {
+    buffer_.reserve(capacity);
+  }
+
+  StreamWriter& start_map() { return open('{'); }
+  StreamWriter& end_map() { return close('}'); }
+  StreamWriter& start_array() { return open('['); }
+  StreamWriter& end_array() { return close(']'); }
+
+  StreamWriter& key(const std::string& key) { return this->key(key.data(), key.size()); }
+  StreamWriter& key(const char* key) { return this->key(key, std::strlen(key)); }
+  StreamWriter& key(const char* key, size_t size) {
+    separate();
+    escape(key, size);
+    buffer_.push_back(':');
+    after_key_ = true;
+    return *this;
+  }
+
+  StreamWriter& value(const std::string& value) { separate(); escape(value.data(), value.size()); return *this; }
+  StreamWriter& value(const char* value) { separate(); escape(value, std::strlen(value)); return *this; }
+  StreamWriter& value(const char* value, size_t size) { separate(); escape(value, size); return *this; }
+  StreamWriter& value(uint64_t value) { separate(); write_unsigned(value); return *this; }
+  StreamWriter& value(int64_t value) {
+    separate();
+    if(value < 0) {
+      buffer_.push_back('-');
+      write_unsigned(~static_cast<uint64_t>(value) + 1);
+    }
+    else
+      write_unsigned(value);
+    return *this;
+  }
+  StreamWriter& value(fp_t value) {
+    separate();
+    char digits[64];
+    size_t length = to_chars(value, digits, sizeof(digits));
+    if(length < sizeof(digits))
+      buffer_.append(digits, length);
+    else {
+      std::vector<char> more(length + 1);
+      to_chars(value, more.data(), more.size());
+      buffer_.append(more.data(), length);
+    }
+    return *this;
+  }
+  StreamWriter& value(bool value) { separate(); buffer_.append(value ? "true" : "false"); return *this; }
+  StreamWriter& value(std::nullptr_t) { separate(); buffer_.append("null"); return *this; }
+  //write a value from the tree, to mix the two
+  StreamWriter& value(const Value& value);
+
+  //write a key and its value
+  template <class T>
+  StreamWriter& operator()(const char* key, const T& value) { return this->key(key).value(value); }
+
+  const std::string& str() const { return buffer_; }
+  size_t size() const { return buffer_.size(); }
+  //start again, keeping the memory
+  void clear() { buffer_.clear(); first_.clear(); after_key_ = false; }
+
+  friend std::ostream& operator<<(std::ostream& stream, const StreamWriter& writer) {
+    return stream.write(writer.buffer_.data(), writer.buffer_.size());
+  }
+
+ private:
+  std::string buffer_;
+  //whether the map or array at each depth has no values yet
+  std::vector<bool> first_;
+  //whether a key was just written so its value needs no separator
+  bool after_key_;
+
+  void separate() {
+    if(after_key_)
+      after_key_ = false;
+    else if(!first_.empty()) {
+      if(!first_.back())
+        buffer_.push_back(',');
+      first_.back() = false;
+    }
+  }
+
+  StreamWriter& open(char bracket) {
+    separate();
+    buffer_.push_back(bracket);
+    first_.push_back(true);
+    return *this;
+  }
+
+  StreamWriter& close(char bracket) {
+    first_.pop_back();
+    buffer_.push_back(bracket);
+    return *this;
+  }
+
+  void write_unsigned(uint64_t value) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* begin = end;
+    do {
+      *--begin = '0' + value % 10;
+      value /= 10;
+    } while(value);
+    buffer_.append(begin, end);
+  }
+
+  void escape(const char* value, size_t size) {
+    static const char hex[] = "0123456789ABCDEF";
+    buffer_.push_back('"');
+    for(size_t i = 0; i < size; ++i) {
+      const char c = value[i];
+      switch (c) {
+      case '\\': buffer_.append("\\\\"); break;
+      case '"': buffer_.append("\\\""); break;
+      case '/': buffer_.append("\\/"); break;
+      case '\b': buffer_.append("\\b"); break;
+      case '\f': buffer_.append("\\f"); break;
+      case '\n': buffer_.append("\\n"); break;
+      case '\r': buffer_.append("\\r"); break;
+      case '\t': buffer_.append("\\t"); break;
+      default:
+        if(c >= 0 && c < 32) {
+          buffer_.append("\\u00");
+          buffer_.push_back(hex[c >> 4]);
+          buffer_.push_back(hex[c & 0xf]);
+        }
+        else
+          buffer_.push_back(c);
+        break;
+      }
+    }
+    buffer_.push_back('"');
+  }
+};
+
+//how we write the different tree values with a stream writer
+class StreamWriterVisitor : public boost::static_visitor<>
+{
+ public:
+  StreamWriterVisitor(StreamWriter& w):writer_(w){}
+
+  template <class T>
+  void operator()(const T& value) const { writer_.value(value); }
+  void operator()(const MapPtr& value) const {
+    writer_.start_map();
+    for(const auto& key_value : *value) {
+      writer_.key(key_value.first);
+      boost::apply_visitor(*this, key_value.second);
+    }
+    writer_.end_map();
+  }
+  void operator()(const ArrayPtr& value) const {
+    writer_.start_array();
+    for(const auto& element : *value)
+      boost::apply_visitor(*this, element);
+    writer_.end_array();
+  }
+ private:
+  StreamWriter& writer_;
+};
+
+inline StreamWriter& StreamWriter::value(const Value& value) {
+  boost::apply_visitor(StreamWriterVisitor(*this), value);
+  return *this;
+}
+
 inline MapPtr map(std::initializer_list<Jmap::value_type> list) {
   return MapPtr(new Jmap(list));
 }
@@ -0,0 +1,359 @@
+#ifndef VALHALLA_BALDR_JSON_ARENA_H_
+#define VALHALLA_BALDR_JSON_ARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/json.h>
+
+namespace valhalla {
+namespace baldr {
+namespace json {
+
+class Arena;
+class ArenaMap;
+class ArenaArray;
+
+//text copied into an arena, not null terminated
+struct ArenaString {
+  const char* data;
+  size_t size;
+  std::string str() const { return std::string(data, size); }
+  bool operator==(const char* other) const {
+    return std::strlen(other) == size && std::memcmp(data, other, size) == 0;
+  }
+};
+
+/**
+ * A value in an arena backed json DOM. Strings, maps and arrays live in the
+ * arena so values are trivially copyable and nothing needs to be destroyed,
+ * the whole document is freed at once with its arena.
+ */
+class ArenaValue {
+ public:
+  enum class Type : uint8_t { String, Unsigned, Signed, Fp, Bool, Null, Map, Array };
+
+  Type type() const { return type_; }
+  const ArenaString& get_string() const { return string_; }
+  uint64_t get_unsigned() const { return unsigned_; }
+  int64_t get_signed() const { return signed_; }
+  const fp_t& get_fp() const { return fp_; }
+  bool get_bool() const { return bool_; }
+  const ArenaMap& get_map() const { return *map_; }
+  const ArenaArray& get_array() const { return *array_; }
+
+  //write it out, maps and arrays in the order they were filled
+  void write(StreamWriter& writer) const;
+
+ protected:
+  friend class ArenaMap;
+  friend class ArenaArray;
+
+  Type type_;
+  union {
+    ArenaString string_;
+    uint64_t unsigned_;
+    int64_t signed_;
+    fp_t fp_;
+    bool bool_;
+    ArenaMap* map_;
+    ArenaArray* array_;
+  };
+
+  void set(Arena& arena, const std::string& value);
+  void set(Arena& arena, const char* value);
+  void set(Arena&, uint64_t value) { type_ = Type::Unsigned; unsigned_ = value; }
+  void set(Arena&, int64_t value) { type_ = Type::Signed; signed_ = value; }
+  void set(Arena&, const fp_t& value) { type_ = Type::Fp; fp_ = value; }
+  void set(Arena&, bool value) { type_ = Type::Bool; bool_ = value; }
+  void set(Arena&, std::nullptr_t) { type_ = Type::Null; }
+  void set(ArenaMap* value) { type_ = Type::Map; map_ = value; }
+  void set(ArenaArray* value) { type_ = Type::Array; array_ = value; }
+};
+
+/**
+ * Bump allocator for an arena backed json DOM. Memory is taken from large
+ * blocks and never given back one piece at a time, clear() or destroying the
+ * arena frees every map, array and string made from it. Anything made from
+ * the arena must not be used after that.
+ *
+ *   json::Arena arena;
+ *   auto& feature = arena.map();
+ *   feature.emplace("type", "Feature");
+ *   feature.map("properties").emplace("id", uint64_t(7));
+ *   std::cout << feature;
+ */
+class Arena {
+ public:
+  explicit Arena(size_t block_size = 64 * 1024)
+      : block_size_(block_size), next_(nullptr), end_(nullptr), large_size_(0) {
+  }
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  //a new empty map or array
+  ArenaMap& map();
+  ArenaArray& array();
+
+  //frees everything made from the arena, keeping the first block for reuse
+  void clear() {
+    large_.clear();
+    large_size_ = 0;
+    if(blocks_.empty())
+      return;
+    blocks_.resize(1);
+    next_ = blocks_.front().get();
+    end_ = next_ + block_size_;
+  }
+
+  //bytes of memory held by the arena
+  size_t capacity() const {
+    return blocks_.size() * block_size_ + large_size_;
+  }
+
+  //uninitialized memory for count objects of type T
+  template <class T>
+  T* allocate(size_t count) {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned");
+    size_t size = sizeof(T) * count;
+    uintptr_t address = reinterpret_cast<uintptr_t>(next_);
+    size_t padding = (alignof(T) - address % alignof(T)) % alignof(T);
+    if(next_ == nullptr || padding + size > static_cast<size_t>(end_ - next_)) {
+      //too big to share a block, it gets one of its own
+      if(size > block_size_ / 4) {
+        large_.emplace_back(new char[size]);
+        large_size_ += size;
+        return reinterpret_cast<T*>(large_.back().get());
+      }
+      blocks_.emplace_back(new char[block_size_]);
+      next_ = blocks_.back().get();
+      end_ = next_ + block_size_;
+      padding = 0;
+    }
+    T* memory = reinterpret_cast<T*>(next_ + padding);
+    next_ += padding + size;
+    return memory;
+  }
+
+  //a copy of some text
+  ArenaString copy(const char* text, size_t size) {
+    char* data = allocate<char>(size);
+    std::memcpy(data, text, size);
+    return ArenaString{data, size};
+  }
+
+ protected:
+  size_t block_size_;
+  std::vector<std::unique_ptr<char[]> > blocks_;
+  char* next_;
+  char* end_;
+  //allocations too big for the blocks
+  std::vector<std::unique_ptr<char[]> > large_;
+  size_t large_size_;
+};
+
+/**
+ * A json map as contiguous key value pairs in an arena. Keys keep the order
+ * they were added in and are not checked for duplicates, so the output is
+ * always the same for the same document. Lookups are linear, which is what
+ * the small maps of a json response want.
+ */
+class ArenaMap {
+ public:
+  struct member_t {
+    ArenaString key;
+    ArenaValue value;
+  };
+  using const_iterator = const member_t*;
+
+  explicit ArenaMap(Arena& arena)
+      : arena_(&arena), members_(nullptr), size_(0), capacity_(0) {
+  }
+
+  //add a key with a string, number, fp_t, bool or null value
+  template <class T>
+  ArenaMap& emplace(const char* key, const T& value) {
+    return emplace(key, std::strlen(key), value);
+  }
+  template <class T>
+  ArenaMap& emplace(const std::string& key, const T& value) {
+    return emplace(key.data(), key.size(), value);
+  }
+
+  //add a key with a new empty map or array, which is returned to be filled
+  ArenaMap& map(const char* key) {
+    auto& child = arena_->map();
+    add(key, std::strlen(key)).set(&child);
+    return child;
+  }
+  ArenaArray& array(const char* key) {
+    auto& child = arena_->array();
+    add(key, std::strlen(key)).set(&child);
+    return child;
+  }
+
+  //the first value with the key or nullptr
+  const ArenaValue* find(const char* key) const {
+    for(const auto& member : *this)
+      if(member.key == key)
+        return &member.value;
+    return nullptr;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const_iterator begin() const { return members_; }
+  const_iterator end() const { return members_ + size_; }
+
+  void write(StreamWriter& writer) const {
+    writer.start_map();
+    for(const auto& member : *this) {
+      writer.key(member.key.data, member.key.size);
+      member.value.write(writer);
+    }
+    writer.end_map();
+  }
+
+  friend std::ostream& operator<<(std::ostream& stream, const ArenaMap& map) {
+    StreamWriter writer;
+    map.write(writer);
+    return stream << writer;
+  }
+
+ protected:
+  Arena* arena_;
+  member_t* members_;
+  uint32_t size_;
+  uint32_t capacity_;
+
+  template <class T>
+  ArenaMap& emplace(const char* key, size_t size, const T& value) {
+    add(key, size).set(*arena_, value);
+    return *this;
+  }
+
+  ArenaValue& add(const char* key, size_t size) {
+    //outgrown members stay in the arena until it is cleared
+    if(size_ == capacity_) {
+      capacity_ = std::max<uint32_t>(4, capacity_ * 2);
+      member_t* members = arena_->allocate<member_t>(capacity_);
+      if(size_)
+        std::memcpy(members, members_, sizeof(member_t) * size_);
+      members_ = members;
+    }
+    auto& member = members_[size_++];
+    member.key = arena_->copy(key, size);
+    return member.value;
+  }
+};
+
+/**
+ * A json array as contiguous values in an arena.
+ */
+class ArenaArray {
+ public:
+  using const_iterator = const ArenaValue*;
+
+  explicit ArenaArray(Arena& arena)
+      : arena_(&arena), values_(nullptr), size_(0), capacity_(0) {
+  }
+
+  //add a string, number, fp_t, bool or null value
+  template <class T>
+  ArenaArray& push_back(const T& value) {
+    add().set(*arena_, value);
+    return *this;
+  }
+
+  //add a new empty map or array, which is returned to be filled
+  ArenaMap& map() {
+    auto& child = arena_->map();
+    add().set(&child);
+    return child;
+  }
+  ArenaArray& array() {
+    auto& child = arena_->array();
+    add().set(&child);
+    return child;
+  }
+
+  const ArenaValue& operator[](size_t index) const { return values_[index]; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const_iterator begin() const { return values_; }
+  const_iterator end() const { return values_ + size_; }
+
+  void write(StreamWriter& writer) const {
+    writer.start_array();
+    for(const auto& value : *this)
+      value.write(writer);
+    writer.end_array();
+  }
+
+  friend std::ostream& operator<<(std::ostream& stream, const ArenaArray& array) {
+    StreamWriter writer;
+    array.write(writer);
+    return stream << writer;
+  }
+
+ protected:
+  Arena* arena_;
+  ArenaValue* values_;
+  uint32_t size_;
+  uint32_t capacity_;
+
+  ArenaValue& add() {
+    if(size_ == capacity_) {
+      capacity_ = std::max<uint32_t>(4, capacity_ * 2);
+      ArenaValue* values = arena_->allocate<ArenaValue>(capacity_);
+      if(size_)
+        std::memcpy(values, values_, sizeof(ArenaValue) * size_);
+      values_ = values;
+    }
+    return values_[size_++];
+  }
+};
+
+inline ArenaMap& Arena::map() {
+  return *new (allocate<ArenaMap>(1)) ArenaMap(*this);
+}
+
+inline ArenaArray& Arena::array() {
+  return *new (allocate<ArenaArray>(1)) ArenaArray(*this);
+}
+
+inline void ArenaValue::set(Arena& arena, const std::string& value) {
+  type_ = Type::String;
+  string_ = arena.copy(value.data(), value.size());
+}
+
+inline void ArenaValue::set(Arena& arena, const char* value) {
+  type_ = Type::String;
+  string_ = arena.copy(value, std::strlen(value));
+}
+
+inline void ArenaValue::write(StreamWriter& writer) const {
+  switch(type_) {
+    case Type::String: writer.value(string_.data, string_.size); break;
+    case Type::Unsigned: writer.value(unsigned_); break;
+    case Type::Signed: writer.value(signed_); break;
+    case Type::Fp: writer.value(fp_); break;
+    case Type::Bool: writer.value(bool_); break;
+    case Type::Null: writer.value(nullptr); break;
+    case Type::Map: map_->write(writer); break;
+    case Type::Array: array_->write(writer); break;
+  }
+}
+
+}
+}
+}
+
+#endif //VALHALLA_BALDR_JSON_ARENA_H_
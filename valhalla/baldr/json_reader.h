@@ -0,0 +1,429 @@
+#ifndef VALHALLA_BALDR_JSON_READER_H_
+#define VALHALLA_BALDR_JSON_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace valhalla {
+namespace baldr {
+namespace json {
+
+//a piece of the text being read, not null terminated
+struct Slice {
+  const char* data;
+  size_t size;
+  std::string str() const { return std::string(data, size); }
+  bool operator==(const char* other) const {
+    return std::strlen(other) == size && std::memcmp(data, other, size) == 0;
+  }
+  bool operator!=(const char* other) const { return !(*this == other); }
+};
+
+/**
+ * Pulls values out of json text one at a time, without building a tree.
+ * Strings without escapes are returned as slices of the text itself, only
+ * strings with escapes are decoded, into a buffer which is reused. The text
+ * must outlive the reader and a slice from string() is only good until the
+ * next string is read. Malformed json throws std::runtime_error.
+ *
+ *   json::Reader reader(text);
+ *   reader.start_map();
+ *   json::Slice key;
+ *   while(reader.next_key(key)) {
+ *     if(key == "lat")
+ *       lat = reader.number();
+ *     else
+ *       reader.skip();
+ *   }
+ *   reader.finish();
+ */
+class Reader {
+ public:
+  enum class Type : uint8_t { String, Number, Bool, Null, Map, Array };
+
+  Reader(const char* json, size_t size)
+    : begin_(json), pos_(json), end_(json + size), opened_(false) {
+  }
+  explicit Reader(const std::string& json) : Reader(json.data(), json.size()) {
+  }
+
+  //what kind of value is next
+  Type peek() {
+    skip_space();
+    if(pos_ == end_)
+      error("a value");
+    switch(*pos_) {
+      case '"': return Type::String;
+      case '{': return Type::Map;
+      case '[': return Type::Array;
+      case 't': case 'f': return Type::Bool;
+      case 'n': return Type::Null;
+      default:
+        if(*pos_ == '-' || (*pos_ >= '0' && *pos_ <= '9'))
+          return Type::Number;
+        error("a value");
+    }
+    return Type::Null;
+  }
+
+  //maps are read with start_map and then next_key until it returns false
+  void start_map() { expect('{'); opened_ = true; }
+  bool next_key(Slice& key) {
+    if(!next('}'))
+      return false;
+    key = string();
+    expect(':');
+    return true;
+  }
+
+  //arrays are read with start_array and next_element until it returns false
+  void start_array() { expect('['); opened_ = true; }
+  bool next_element() { return next(']'); }
+
+  Slice string() {
+    skip_space();
+    if(pos_ == end_ || *pos_ != '"')
+      error("a string");
+    const char* start = ++pos_;
+    while(pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+      if(static_cast<unsigned char>(*pos_) < 0x20)
+        error("no control characters in a string");
+      ++pos_;
+    }
+    if(pos_ == end_)
+      error("the end of a string");
+    if(*pos_ == '"')
+      return Slice{start, static_cast<size_t>(pos_++ - start)};
+    scratch_.assign(start, pos_);
+    return unescape();
+  }
+
+  double number() { return to_double(number_text()); }
+
+  //the text of the next number, checked to be a json number
+  Slice number_text() {
+    skip_space();
+    const char* start = pos_;
+    if(pos_ != end_ && *pos_ == '-')
+      ++pos_;
+    if(pos_ == end_ || !digit(*pos_))
+      error("a number");
+    if(*pos_++ != '0')
+      while(pos_ != end_ && digit(*pos_))
+        ++pos_;
+    if(pos_ != end_ && *pos_ == '.') {
+      if(++pos_ == end_ || !digit(*pos_))
+        error("a digit");
+      while(pos_ != end_ && digit(*pos_))
+        ++pos_;
+    }
+    if(pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+      if(++pos_ != end_ && (*pos_ == '+' || *pos_ == '-'))
+        ++pos_;
+      if(pos_ == end_ || !digit(*pos_))
+        error("a digit");
+      while(pos_ != end_ && digit(*pos_))
+        ++pos_;
+    }
+    return Slice{start, static_cast<size_t>(pos_ - start)};
+  }
+
+  bool boolean() {
+    if(literal("true"))
+      return true;
+    if(literal("false"))
+      return false;
+    error("true or false");
+    return false;
+  }
+
+  void null() {
+    if(!literal("null"))
+      error("null");
+  }
+
+  //the text of a string, number, bool or null
+  Slice scalar() {
+    const char* start;
+    switch(peek()) {
+      case Type::String: return string();
+      case Type::Number: return number_text();
+      case Type::Bool: start = pos_; boolean(); break;
+      case Type::Null: start = pos_; null(); break;
+      default: error("a string, number, bool or null");
+    }
+    return Slice{start, static_cast<size_t>(pos_ - start)};
+  }
+
+  //skip over the next value whatever it is
+  void skip(size_t depth = 0) {
+    if(depth > kMaxDepth)
+      error("less nesting");
+    Slice key;
+    switch(peek()) {
+      case Type::String: string(); break;
+      case Type::Number: number_text(); break;
+      case Type::Bool: boolean(); break;
+      case Type::Null: null(); break;
+      case Type::Map:
+        start_map();
+        while(next_key(key))
+          skip(depth + 1);
+        break;
+      case Type::Array:
+        start_array();
+        while(next_element())
+          skip(depth + 1);
+        break;
+    }
+  }
+
+  //check nothing but whitespace is left
+  void finish() {
+    skip_space();
+    if(pos_ != end_)
+      error("the end of the json");
+  }
+
+  //how far into the text the reader is
+  size_t offset() const { return pos_ - begin_; }
+
+  /**
+   * Converts the text of a json number. Numbers with at most 19 significant
+   * digits whose value and power of 10 are exactly representable are scaled
+   * directly, which is exact, everything else is left to the C++ library.
+   * @param text  a json number
+   * @return the closest double
+   */
+  static double to_double(const Slice& text) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+      1e20, 1e21, 1e22};
+    const char* c = text.data;
+    const char* end = c + text.size;
+    bool negative = c != end && *c == '-';
+    c += negative;
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool valid = c != end;
+    for(; c != end && digit(*c); ++c, ++digits)
+      mantissa = mantissa * 10 + (*c - '0');
+    if(c != end && *c == '.')
+      for(++c; c != end && digit(*c); ++c, ++digits, --exponent)
+        mantissa = mantissa * 10 + (*c - '0');
+    if(c != end && (*c == 'e' || *c == 'E')) {
+      ++c;
+      bool negative_exponent = c != end && *c == '-';
+      c += c != end && (*c == '-' || *c == '+');
+      int e = 0;
+      for(; c != end && digit(*c) && e < 10000; ++c)
+        e = e * 10 + (*c - '0');
+      exponent += negative_exponent ? -e : e;
+    }
+    valid = valid && c == end;
+    if(valid && digits <= 19 && mantissa <= (uint64_t(1) << 53) &&
+       exponent >= -22 && exponent <= 22) {
+      double value = static_cast<double>(mantissa);
+      value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+      return negative ? -value : value;
+    }
+
+    //the long way, without the locale's decimal point
+    std::istringstream stream(text.str());
+    stream.imbue(std::locale::classic());
+    double value;
+    stream >> value;
+    if(stream.fail() || !(stream >> std::ws).eof())
+      throw std::runtime_error("Expected a number but got " + text.str());
+    return value;
+  }
+
+  /**
+   * Converts the text of a json integer.
+   * @param text   a json number
+   * @param value  set to the integer
+   * @return false if it is not an integer or does not fit
+   */
+  static bool to_integer(const Slice& text, int64_t& value) {
+    const char* c = text.data;
+    const char* end = c + text.size;
+    bool negative = c != end && *c == '-';
+    c += negative;
+    if(c == end)
+      return false;
+    uint64_t magnitude = 0;
+    uint64_t limit = negative ? uint64_t(1) << 63 : (uint64_t(1) << 63) - 1;
+    for(; c != end; ++c) {
+      if(!digit(*c) || magnitude > (limit - (*c - '0')) / 10)
+        return false;
+      magnitude = magnitude * 10 + (*c - '0');
+    }
+    value = negative ? static_cast<int64_t>(~magnitude + 1) : static_cast<int64_t>(magnitude);
+    return true;
+  }
+  static bool to_unsigned(const Slice& text, uint64_t& value) {
+    const char* c = text.data;
+    const char* end = c + text.size;
+    if(c == end)
+      return false;
+    uint64_t magnitude = 0;
+    for(; c != end; ++c) {
+      if(!digit(*c) || magnitude > (std::numeric_limits<uint64_t>::max() - (*c - '0')) / 10)
+        return false;
+      magnitude = magnitude * 10 + (*c - '0');
+    }
+    value = magnitude;
+    return true;
+  }
+
+ protected:
+  static constexpr size_t kMaxDepth = 256;
+
+  const char* begin_;
+  const char* pos_;
+  const char* end_;
+  //whether a map or array was just started so the next member has no comma
+  bool opened_;
+  //strings with escapes are decoded here
+  std::string scratch_;
+
+  static bool digit(char c) {
+    return c >= '0' && c <= '9';
+  }
+
+  void skip_space() {
+    while(pos_ != end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t'))
+      ++pos_;
+  }
+
+  [[noreturn]] void error(const char* expected) const {
+    throw std::runtime_error(std::string("Malformed json, expected ") + expected +
+      " at offset " + std::to_string(pos_ - begin_));
+  }
+
+  void expect(char c) {
+    skip_space();
+    if(pos_ == end_ || *pos_ != c) {
+      char expected[] = {'\'', c, '\'', '\0'};
+      error(expected);
+    }
+    ++pos_;
+  }
+
+  //moves to the next member of a map or array, false if it closed instead
+  bool next(char close) {
+    skip_space();
+    if(pos_ != end_ && *pos_ == close) {
+      ++pos_;
+      opened_ = false;
+      return false;
+    }
+    if(!opened_)
+      expect(',');
+    opened_ = false;
+    return true;
+  }
+
+  bool literal(const char* text) {
+    skip_space();
+    size_t size = std::strlen(text);
+    if(static_cast<size_t>(end_ - pos_) < size || std::memcmp(pos_, text, size) != 0)
+      return false;
+    pos_ += size;
+    return true;
+  }
+
+  uint32_t hex4() {
+    if(end_ - pos_ < 4)
+      error("4 hex digits");
+    uint32_t code = 0;
+    for(int i = 0; i < 4; ++i, ++pos_) {
+      char c = *pos_;
+      code <<= 4;
+      if(digit(c)) code |= c - '0';
+      else if(c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+      else if(c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+      else error("4 hex digits");
+    }
+    return code;
+  }
+
+  void append_utf8(uint32_t code) {
+    if(code < 0x80)
+      scratch_.push_back(static_cast<char>(code));
+    else if(code < 0x800) {
+      scratch_.push_back(static_cast<char>(0xC0 | (code >> 6)));
+      scratch_.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else if(code < 0x10000) {
+      scratch_.push_back(static_cast<char>(0xE0 | (code >> 12)));
+      scratch_.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      scratch_.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else {
+      scratch_.push_back(static_cast<char>(0xF0 | (code >> 18)));
+      scratch_.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      scratch_.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      scratch_.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+
+  //decodes the rest of a string from its first escape on
+  Slice unescape() {
+    while(true) {
+      if(pos_ == end_)
+        error("the end of a string");
+      char c = *pos_++;
+      if(c == '"')
+        break;
+      if(static_cast<unsigned char>(c) < 0x20)
+        error("no control characters in a string");
+      if(c != '\\') {
+        scratch_.push_back(c);
+        continue;
+      }
+      if(pos_ == end_)
+        error("an escape");
+      switch(*pos_++) {
+        case '"': scratch_.push_back('"'); break;
+        case '\\': scratch_.push_back('\\'); break;
+        case '/': scratch_.push_back('/'); break;
+        case 'b': scratch_.push_back('\b'); break;
+        case 'f': scratch_.push_back('\f'); break;
+        case 'n': scratch_.push_back('\n'); break;
+        case 'r': scratch_.push_back('\r'); break;
+        case 't': scratch_.push_back('\t'); break;
+        case 'u': {
+          uint32_t code = hex4();
+          //a surrogate pair makes one code point
+          if(code >= 0xD800 && code < 0xDC00 && end_ - pos_ >= 6 && pos_[0] == '\\' && pos_[1] == 'u') {
+            pos_ += 2;
+            uint32_t low = hex4();
+            if(low >= 0xDC00 && low < 0xE000)
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            else {
+              append_utf8(code);
+              code = low;
+            }
+          }
+          append_utf8(code);
+          break;
+        }
+        default: --pos_; error("an escape");
+      }
+    }
+    return Slice{scratch_.data(), scratch_.size()};
+  }
+};
+
+}
+}
+}
+
+#endif //VALHALLA_BALDR_JSON_READER_H_
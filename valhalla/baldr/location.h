@@ -3,6 +3,7 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
 
 #include <valhalla/midgard/pointll.h>
 
@@ -11,6 +12,10 @@
 namespace valhalla{
 namespace baldr{
 
+namespace json {
+class Reader;
+}
+
 /**
  * Input from the outside world to be used in determining where in the graph
  * the route needs to go. A start, middle, destination or via point
@@ -55,6 +60,25 @@ struct Location {
    */
   static Location FromJson(const std::string& json);
 
+  /**
+   * conversion. Reads the same as FromPtree would: the first of a repeated
+   * key wins and a map or array where text is expected is taken as "".
+   * @param  reader  a json reader whose next value is a location object
+   */
+  static Location FromJson(json::Reader& reader);
+
+  /**
+   * conversion.
+   * @param  json  a json array of locations
+   */
+  static std::vector<Location> FromJsonArray(const std::string& json);
+
+  /**
+   * conversion.
+   * @param  reader  a json reader whose next value is an array of locations
+   */
+  static std::vector<Location> FromJsonArray(json::Reader& reader);
+
   /**
    * conversion.
    * @param  csv  a csv representation of the location
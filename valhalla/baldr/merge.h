@@ -1,7 +1,15 @@
 #ifndef VALHALLA_BALDR_MERGE_H_
 #define VALHALLA_BALDR_MERGE_H_
 
+#include <atomic>
+#include <climits>
 #include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 
@@ -19,6 +27,27 @@ struct segment {
   GraphId edge() const { return m_edge; }
 };
 
+// a contiguous range of edges held elsewhere.
+struct edge_span {
+  const GraphId *m_begin, *m_end;
+  edge_span(const GraphId *begin, const GraphId *end) : m_begin(begin), m_end(end) {}
+  const GraphId *begin() const { return m_begin; }
+  const GraphId *end() const { return m_end; }
+  size_t size() const { return m_end - m_begin; }
+  bool empty() const { return m_begin == m_end; }
+  const GraphId &operator[](size_t i) const { return m_begin[i]; }
+};
+
+// a path whose edges are held in a buffer owned by someone else. it is only
+// valid during the call it is passed to, the buffer is reused for the next
+// path. use path to keep a copy.
+struct path_view {
+  GraphId m_start, m_end;
+  edge_span m_edges;
+
+  path_view(GraphId start, GraphId end, edge_span edges);
+};
+
 // a path is a start node, end node and a collection of contiguous edges between
 // them. it is created by concatenating segments.
 struct path {
@@ -27,17 +56,41 @@ struct path {
 
   explicit path(segment s);
   explicit path(GraphId node_id);
+  explicit path(const path_view &p);
 
   void push_back(segment s);
   void push_front(segment s);
 };
 
+// a batch of paths with the edges of all of them stored contiguously, so that
+// emitting a batch allocates nothing once the batch has grown to its working
+// size.
+struct path_batch {
+  void push_back(const path_view &p);
+  void clear();
+  size_t size() const { return m_nodes.size() / 2; }
+  bool empty() const { return m_nodes.empty(); }
+  path_view operator[](size_t i) const;
+
+private:
+  // start and end node of each path
+  std::vector<GraphId> m_nodes;
+  // the edges of all paths, and the offset of the first edge of each path
+  // followed by the total edge count
+  std::vector<GraphId> m_edges;
+  std::vector<size_t> m_offsets = {0};
+};
+
 namespace detail {
 
 // a place we can mark what edges we've seen, even for the planet we should
 // need ~ 100mb, as it allocates one bit per ID. there are currently around
 // 453 million ways in OSM, and we might allocate two edge IDs per way,
 // giving something like 108mb of bits needed.
+//
+// the bits are atomic so that threads can mark edges concurrently. relaxed
+// ordering is enough as each bit is only ever set, and threads are joined
+// before the bits are read by anything other than the thread which set them.
 struct bitset_t {
   typedef uint64_t value_type;
   static const size_t bits_per_value = sizeof(value_type) * CHAR_BIT;
@@ -48,8 +101,17 @@ struct bitset_t {
   void set(const uint64_t id);
   bool get(const uint64_t id) const;
 
+  // versions of set and get without the bounds check, for callers which
+  // already know the id is in range.
+  inline void set_unchecked(const uint64_t id) {
+    bits[id / u64_size].fetch_or(u64_one << (id % u64_size), std::memory_order_relaxed);
+  }
+  inline bool get_unchecked(const uint64_t id) const {
+    return bits[id / u64_size].load(std::memory_order_relaxed) & (u64_one << (id % u64_size));
+  }
+
 protected:
-  std::vector<value_type> bits;
+  std::vector<std::atomic<value_type> > bits;
 
   // return ceil(n / q) = r, such that r * q >= n.
   static inline constexpr size_t div_round_up(size_t n, size_t q) {
@@ -68,14 +130,55 @@ protected:
 // A TileSet is used to enumerate all relevant tiles, and the range of tile IDs
 // is used to construct a compact range by concatenating all the existing
 // compact ranges for each tile.
+//
+// the offset of each tile's range is kept in a flat array per level, indexed
+// by tile ID, so that finding it is a couple of loads rather than a hash
+// lookup. the offsets are a prefix sum of the edge counts of the tiles in
+// tile set order. tiles outside the tile set have the offset no_tile.
 struct edge_tracker {
-  typedef std::unordered_map<GraphId, uint64_t> edge_index_t;
+  typedef std::vector<std::vector<uint64_t> > edge_index_t;
+  static const uint64_t no_tile = std::numeric_limits<uint64_t>::max();
 
   template <typename TileSet>
   static edge_tracker create(TileSet &tiles, GraphReader &reader);
 
-  bool get(const GraphId &edge_id) const;
-  void set(const GraphId &edge_id);
+  // returns an index with a slot for every tile of every level of the
+  // hierarchy, none of which are in the tile set yet.
+  static edge_index_t make_index(GraphReader &reader);
+
+  // returns the offset of the first edge of the tile, or no_tile if it isn't
+  // in the tile set.
+  inline uint64_t tile_offset(const GraphId &id) const {
+    const auto level = id.level();
+    const auto tileid = id.tileid();
+    if (level >= m_edges_in_tiles.size() || tileid >= m_edges_in_tiles[level].size()) {
+      return no_tile;
+    }
+    return m_edges_in_tiles[level][tileid];
+  }
+
+  // edges in tiles outside the tile set have no bits. they are reported as
+  // already visited so that paths are not explored from them, and marking
+  // them does nothing.
+  inline bool get(const GraphId &edge_id) const {
+    const auto offset = tile_offset(edge_id);
+    if (offset == no_tile) {
+      return true;
+    }
+    return m_edge_set.get_unchecked(offset + edge_id.id());
+  }
+
+  inline void set(const GraphId &edge_id) {
+    const auto offset = tile_offset(edge_id);
+    if (offset != no_tile) {
+      m_edge_set.set_unchecked(offset + edge_id.id());
+    }
+  }
+
+  // returns true if node a comes before node b in tile set order, that is
+  // a's tile comes earlier in the tile set or they share a tile and a has
+  // the lower id. nodes in tiles outside the tile set come last.
+  bool before(const GraphId &a, const GraphId &b) const;
 
   edge_index_t m_edges_in_tiles;
   //this is how we know what i've touched and what we havent
@@ -93,10 +196,19 @@ edge_tracker edge_tracker::create(TileSet &tiles, GraphReader &reader) {
   //keep the global number of edges encountered at the point we encounter each tile
   //this allows an edge to have a sequential global id and makes storing it very small
   uint64_t edge_count = 0;
-  edge_tracker::edge_index_t edges_in_tiles;
+  edge_tracker::edge_index_t edges_in_tiles = make_index(reader);
   for (GraphId tile_id : tiles) {
+    // tiles on levels outside the hierarchy, such as transit, need room
+    const auto level = tile_id.level();
+    const auto tileid = tile_id.tileid();
+    if (level >= edges_in_tiles.size()) {
+      edges_in_tiles.resize(level + 1);
+    }
+    if (tileid >= edges_in_tiles[level].size()) {
+      edges_in_tiles[level].resize(tileid + 1, no_tile);
+    }
     //TODO: just read the header, parsing the whole thing isnt worth it at this point
-    edges_in_tiles.emplace(tile_id, edge_count);
+    edges_in_tiles[level][tileid] = edge_count;
     const auto* tile = reader.GetGraphTile(tile_id);
     edge_count += tile->header()->directededgecount();
     // clear the cache if it is overcommitted to avoid running out of memory.
@@ -108,37 +220,80 @@ edge_tracker edge_tracker::create(TileSet &tiles, GraphReader &reader) {
   return edge_tracker(std::move(edges_in_tiles), edge_count);
 }
 
+// the edges of each path are gathered in buffers owned by the collapser and
+// reused for every path, so exploring allocates nothing once they've grown.
 struct edge_collapser {
-  edge_collapser(GraphReader &reader, edge_tracker &tracker, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path &)> func);
+  edge_collapser(GraphReader &reader, edge_tracker &tracker, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path_view &)> func);
   std::pair<GraphId, GraphId> nodes_reachable_from(GraphId node_id);
   GraphId next_node_id(GraphId last_node_id, GraphId node_id);
   GraphId edge_between(GraphId cur, GraphId next);
+  bool first_in_chain(GraphId node_id);
   void explore(GraphId node_id);
-  void explore(GraphId prev, GraphId cur, path &forward, path &reverse);
+  GraphId explore(GraphId prev, GraphId cur, std::vector<GraphId> &along, std::vector<GraphId> &against);
 
 private:
   GraphReader &m_reader;
   edge_tracker &m_tracker;
   std::function<bool(const DirectedEdge *)> m_edge_predictate;
-  std::function<void(const path &)> m_func;
+  std::function<void(const path_view &)> m_func;
+  std::vector<GraphId> m_forward, m_reverse, m_scratch;
 };
 
+segment single_edge_segment(GraphReader &reader, GraphId edge_id);
 path make_single_edge_path(GraphReader &reader, GraphId edge_id);
 
+std::vector<GraphId> chain_tiles(GraphReader &reader,
+                                 const std::function<bool(const DirectedEdge *)> &edge_pred,
+                                 const std::vector<GraphId> &nodes);
+
+// calls func with a path for each edge which isn't part of a collapsed path.
+template <typename TileSet>
+void emit_single_edges(TileSet &tiles, GraphReader &reader, const edge_tracker &tracker,
+                       const std::function<void(const path_view &)> &func) {
+  for (GraphId tile_id : tiles) {
+    const auto *tile = reader.GetGraphTile(tile_id);
+    const auto num_edges = tile->header()->directededgecount();
+    for (uint32_t i = 0; i < num_edges; ++i) {
+      GraphId edge_id(tile_id.tileid(), tile_id.level(), i);
+      if (!tracker.get(edge_id)) {
+        auto s = single_edge_segment(reader, edge_id);
+        func(path_view(s.start(), s.end(), edge_span(&s.m_edge, &s.m_edge + 1)));
+      }
+    }
+  }
+}
+
+typedef std::function<std::shared_ptr<GraphReader>()> reader_factory_t;
+
+// paths keyed by their first edge. circular paths start at their lowest
+// edge, so their key doesn't depend on where they were explored from.
+typedef std::map<GraphId, path> path_map_t;
+
+path_map_t merge_region(const std::vector<GraphId> &tiles, GraphReader &reader,
+                        std::function<bool(const DirectedEdge *)> edge_pred);
+
+void parallel_merge(const std::vector<GraphId> &tiles, edge_tracker &tracker,
+                    const reader_factory_t &make_reader,
+                    std::function<bool(const DirectedEdge *)> edge_pred,
+                    std::function<void(const path_view &)> func, size_t concurrency);
+
 } // namespace detail
 
 /**
  * Read the graph and merge all compatible edges, calling the provided function
- * with each path that has been found. Each edge in the graph will be part of
- * exactly one path, but paths may contain multiple edges.
+ * with a view of each path that has been found. Each edge in the graph will be
+ * part of exactly one path, but paths may contain multiple edges. Circular
+ * paths start and end where their lowest edge leaves from. The edges
+ * of the view are held in a buffer which is reused for the next path, so no
+ * memory is allocated per path.
  *
  * @param tiles A range object over GraphId for the tiles to consider.
  * @param reader The graph to traverse.
  * @param edge_pred A predicate function which should return true for any edge that can be collapsed.
- * @param func The function to execute for each discovered path.
+ * @param func The function to execute for each discovered path. The view is only valid during the call.
  */
 template <typename TileSet>
-void merge(TileSet &tiles, GraphReader &reader, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path &)> func) {
+void stream_merge(TileSet &tiles, GraphReader &reader, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path_view &)> func) {
   detail::edge_tracker tracker = detail::edge_tracker::create(tiles, reader);
   detail::edge_collapser e(reader, tracker, edge_pred, func);
 
@@ -151,17 +306,141 @@ void merge(TileSet &tiles, GraphReader &reader, std::function<bool(const Directe
     }
   }
 
+  detail::emit_single_edges(tiles, reader, tracker, func);
+}
+
+/**
+ * Read the graph and merge all compatible edges, calling the provided function
+ * with each path that has been found. Each edge in the graph will be part of
+ * exactly one path, but paths may contain multiple edges.
+ *
+ * @param tiles A range object over GraphId for the tiles to consider.
+ * @param reader The graph to traverse.
+ * @param edge_pred A predicate function which should return true for any edge that can be collapsed.
+ * @param func The function to execute for each discovered path.
+ */
+template <typename TileSet>
+void merge(TileSet &tiles, GraphReader &reader, std::function<bool(const DirectedEdge *)> edge_pred, std::function<void(const path &)> func) {
+  stream_merge(tiles, reader, edge_pred, [&func](const path_view &p) {
+    func(path(p));
+  });
+}
+
+/**
+ * Read the graph and merge all compatible edges, calling the provided function
+ * with batches of the paths found, in the same order as merge. Useful for
+ * writers which are more efficient with many paths at a time. The batch is
+ * reused for the next call.
+ *
+ * @param tiles A range object over GraphId for the tiles to consider.
+ * @param reader The graph to traverse.
+ * @param edge_pred A predicate function which should return true for any edge that can be collapsed.
+ * @param batch_size The number of paths in each batch, except perhaps the last.
+ * @param func The function to execute for each batch of paths.
+ */
+template <typename TileSet>
+void batch_merge(TileSet &tiles, GraphReader &reader, std::function<bool(const DirectedEdge *)> edge_pred,
+                 size_t batch_size, std::function<void(const path_batch &)> func) {
+  if (batch_size == 0) {
+    throw std::runtime_error("batch size must be at least 1");
+  }
+  path_batch batch;
+  stream_merge(tiles, reader, edge_pred, [&](const path_view &p) {
+    batch.push_back(p);
+    if (batch.size() == batch_size) {
+      func(batch);
+      batch.clear();
+    }
+  });
+  if (!batch.empty()) {
+    func(batch);
+  }
+}
+
+/**
+ * The paths which changed between two versions of the graph, keyed by their
+ * first edge. A path which changed but still starts with the same edge is in
+ * both, so applying removed before added updates a set of paths keyed the
+ * same way.
+ */
+struct path_delta {
+  std::map<GraphId, path> removed;
+  std::map<GraphId, path> added;
+};
+
+/**
+ * Merge only the paths which have an edge in the given tiles, in a graph
+ * before and after those tiles were rebuilt, and return the difference. The
+ * tiles should be the changed tiles and their neighbours, so that paths
+ * ending at a changed node are included. Paths are followed into tiles
+ * outside the set as far as they go, so the result is the same as running
+ * merge over the whole graph before and after and comparing the paths with
+ * an edge in the given tiles. Circular paths start at their lowest edge in
+ * both, so they are keyed the same whichever tiles they were reached from.
+ *
+ * @param tiles A range object over GraphId for the changed tiles and their neighbours.
+ * @param old_reader The graph before the change.
+ * @param new_reader The graph after the change.
+ * @param edge_pred A predicate function which should return true for any edge that can be collapsed.
+ * @return The paths removed and added by the change.
+ */
+template <typename TileSet>
+path_delta incremental_merge(TileSet &tiles, GraphReader &old_reader, GraphReader &new_reader,
+                             std::function<bool(const DirectedEdge *)> edge_pred) {
+  std::vector<GraphId> tile_ids;
   for (GraphId tile_id : tiles) {
-    const auto *tile = reader.GetGraphTile(tile_id);
-    const auto num_edges = tile->header()->directededgecount();
-    for (uint32_t i = 0; i < num_edges; ++i) {
-      GraphId edge_id(tile_id.tileid(), tile_id.level(), i);
-      if (!tracker.get(edge_id)) {
-        auto p = detail::make_single_edge_path(reader, edge_id);
-        func(p);
-      }
+    tile_ids.push_back(tile_id);
+  }
+  auto before = detail::merge_region(tile_ids, old_reader, edge_pred);
+  auto after = detail::merge_region(tile_ids, new_reader, edge_pred);
+
+  path_delta delta;
+  auto same = [](const path &a, const path &b) {
+    return a.m_start == b.m_start && a.m_end == b.m_end && a.m_edges == b.m_edges;
+  };
+  for (const auto &p : before) {
+    auto itr = after.find(p.first);
+    if (itr == after.end() || !same(p.second, itr->second)) {
+      delta.removed.emplace(p.first, p.second);
+    }
+  }
+  for (auto &p : after) {
+    auto itr = before.find(p.first);
+    if (itr == before.end() || !same(p.second, itr->second)) {
+      delta.added.emplace(p.first, std::move(p.second));
     }
   }
+  return delta;
+}
+
+/**
+ * Parallel version of merge. The tiles are shared out between threads, each
+ * of which uses its own GraphReader. A path is found by the thread working on
+ * the tile of its first collapsible node in tile set order, so every path is
+ * found exactly once whichever tiles its edges cross. The paths are passed to
+ * the provided function on the calling thread, in the same order as merge
+ * would, so the function does not need to be thread-safe.
+ *
+ * @param tiles A range object over GraphId for the tiles to consider.
+ * @param reader The graph used to size the edge tracker.
+ * @param make_reader Called once per thread to make the reader it uses.
+ * @param edge_pred A predicate function which should return true for any edge that can be collapsed. Called concurrently.
+ * @param func The function to execute for each discovered path.
+ * @param concurrency The number of threads to use, 0 for one per core.
+ */
+template <typename TileSet>
+void parallel_merge(TileSet &tiles, GraphReader &reader,
+                    const detail::reader_factory_t &make_reader,
+                    std::function<bool(const DirectedEdge *)> edge_pred,
+                    std::function<void(const path &)> func,
+                    size_t concurrency = 0) {
+  std::vector<GraphId> tile_ids;
+  for (GraphId tile_id : tiles) {
+    tile_ids.push_back(tile_id);
+  }
+  detail::edge_tracker tracker = detail::edge_tracker::create(tile_ids, reader);
+  detail::parallel_merge(tile_ids, tracker, make_reader, edge_pred,
+                         [&func](const path_view &p) { func(path(p)); }, concurrency);
 }
 
 }
@@ -0,0 +1,212 @@
+#ifndef VALHALLA_BALDR_RADIX_HEAP_H_
+#define VALHALLA_BALDR_RADIX_HEAP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Radix Heap. A monotone priority queue with the same add/decrease/pop/clear
+ * interface as DoubleBucketQueue and BucketQueue so algorithms can choose
+ * one at compile time. Unlike the bucket queues costs are not grouped into
+ * fixed size buckets, so labels come out in exact cost order and there is
+ * no overflow bucket to rescan when costs are sparse.
+ *
+ * Non-negative float costs compare the same as their bit patterns, which are
+ * used as the keys. Labels are kept in 33 buckets by the highest bit in which
+ * their key differs from the last popped key. Costs must be monotone: a cost
+ * lower than the last popped cost is treated as equal to it.
+ *
+ * decrease adds the label again and pop skips entries whose key no longer
+ * matches the cost of the label, so the cost functor must reflect decreases.
+ */
+template <typename label_t, typename labelcost_t>
+class RadixHeap {
+ public:
+  /**
+   * Constructor.
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  explicit RadixHeap(const labelcost_t& labelcost)
+      : RadixHeap(0.0f, 0.0f, 1, labelcost) {
+  }
+
+  /**
+   * Constructor with the arguments of DoubleBucketQueue. Only the minimum
+   * cost is used, a radix heap has no cost range or bucket size.
+   * @param mincost    Minimum cost.
+   * @param range      Unused.
+   * @param bucketsize Unused.
+   * @param labelcost  Functor to get a cost given a label index.
+   */
+  RadixHeap(const float mincost, const float /*range*/,
+            const uint32_t /*bucketsize*/, const labelcost_t& labelcost)
+      : startkey_(key(mincost)), labelcost_(labelcost) {
+    clear();
+  }
+
+  /**
+   * Returned by pop when the queue is empty.
+   * @return  Returns the invalid label.
+   */
+  static constexpr label_t invalid() {
+    return std::numeric_limits<label_t>::max();
+  }
+
+  /**
+   * Clear all labels. Buckets keep their capacity.
+   */
+  void clear() {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    last_ = startkey_;
+    size_ = 0;
+  }
+
+  /**
+   * Adds a label index to the heap.
+   * @param   label  Label index to add.
+   * @param   cost   Cost for this label.
+   */
+  void add(const label_t label, const float cost) {
+    push({key(cost), label});
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Adds the label again,
+   * the entry with its previous cost is skipped when popped.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   * @param  previouscost Previous cost (unused).
+   */
+  void decrease(const label_t label, const float newcost,
+                const float /*previouscost*/ = 0.0f) {
+    push({key(newcost), label});
+  }
+
+  /**
+   * Removes the lowest cost label index from the heap.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          invalid() if the heap is empty.
+   */
+  label_t pop() {
+    while (size_ > 0) {
+      if (buckets_[0].empty() && !redistribute()) {
+        break;
+      }
+      entry_t entry = buckets_[0].back();
+      buckets_[0].pop_back();
+      size_--;
+      if (!stale(entry)) {
+        return entry.label;
+      }
+    }
+    return invalid();
+  }
+
+ private:
+  struct entry_t {
+    uint32_t key;
+    label_t label;
+  };
+
+  uint32_t startkey_;   // Key of the minimum cost after clear
+  uint32_t last_;       // Key of the last popped label
+  size_t size_;         // Number of entries (including stale ones)
+  std::vector<entry_t> buckets_[33];
+
+  // Cost function to get cost given the label index.
+  labelcost_t labelcost_;
+
+  /**
+   * Returns the key of a cost. Non-negative floats sort the same as their
+   * bit patterns, negative costs are treated as 0.
+   * @param  cost  Cost.
+   * @return Returns the key.
+   */
+  static uint32_t key(const float cost) {
+    if (!(cost > 0.0f)) {
+      return 0;
+    }
+    uint32_t k;
+    std::memcpy(&k, &cost, sizeof(k));
+    return k;
+  }
+
+  /**
+   * Returns the bucket of a key: the position of the highest bit in which
+   * it differs from the last popped key.
+   * @param  k  Key.
+   * @return Returns the bucket index.
+   */
+  uint32_t bucket_index(const uint32_t k) const {
+    return (k <= last_) ? 0 : 32 - __builtin_clz(k ^ last_);
+  }
+
+  /**
+   * Returns true if the entry is from before a decrease.
+   * @param  entry  Heap entry.
+   * @return Returns true if the label no longer has the entry's cost.
+   */
+  bool stale(const entry_t& entry) const {
+    return key(labelcost_(entry.label)) != entry.key;
+  }
+
+  /**
+   * Adds an entry to its bucket.
+   * @param  entry  Heap entry.
+   */
+  void push(const entry_t& entry) {
+    buckets_[bucket_index(entry.key)].push_back(entry);
+    size_++;
+  }
+
+  /**
+   * Finds the lowest non-empty bucket, makes its minimum key the last key
+   * and moves its entries to lower buckets. Stale entries are dropped.
+   * @return Returns false if there are no entries left.
+   */
+  bool redistribute() {
+    for (uint32_t i = 1; i < 33; i++) {
+      auto& bucket = buckets_[i];
+      if (bucket.empty()) {
+        continue;
+      }
+
+      // Drop stale entries and find the minimum key of the rest
+      uint32_t minkey = std::numeric_limits<uint32_t>::max();
+      size_t live = 0;
+      for (const auto& entry : bucket) {
+        if (!stale(entry)) {
+          minkey = std::min(minkey, entry.key);
+          bucket[live++] = entry;
+        }
+      }
+      size_ -= bucket.size() - live;
+      bucket.resize(live);
+      if (live == 0) {
+        continue;
+      }
+
+      // Entries of the bucket now differ from the last key in lower bits
+      last_ = minkey;
+      for (const auto& entry : bucket) {
+        buckets_[bucket_index(entry.key)].push_back(entry);
+      }
+      bucket.clear();
+      return true;
+    }
+    return false;
+  }
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_RADIX_HEAP_H_
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_TRANSITDEPARTURE_H_
 #define VALHALLA_BALDR_TRANSITDEPARTURE_H_
 
+#include <limits>
 #include <valhalla/baldr/graphconstants.h>
 
 namespace valhalla {
@@ -9,6 +10,9 @@ namespace baldr {
 constexpr uint32_t kFixedSchedule     = 0;
 constexpr uint32_t kFrequencySchedule = 1;
 
+// Returned when there is no departure at or after a given time
+constexpr uint32_t kInvalidDepartureTime = std::numeric_limits<uint32_t>::max();
+
 struct FixedDeparture {
   uint64_t departure_time_  : 17; // Departure time (seconds from midnight)
                                         // (86400 secs per day)
@@ -108,11 +112,29 @@ class TransitDeparture {
   uint32_t headsign_offset() const;
 
   /**
-   * Get the departure time.
+   * Get the departure type (kFixedSchedule or kFrequencySchedule).
+   * @return  Returns the departure type.
+   */
+  uint32_t type() const;
+
+  /**
+   * Get the departure time. For frequency based departures this is the
+   * start time of the departures.
    * @return  Returns the departure time in seconds from midnight.
    */
   uint32_t departure_time() const;
 
+  /**
+   * Get the time of the first departure at or after the given time. For
+   * frequency based departures this is the first departure in the series
+   * start_time, start_time + frequency, ... that is not after end_time.
+   * @param   current_time  Time in seconds from midnight.
+   * @return  Returns the departure time in seconds from midnight or
+   *          kInvalidDepartureTime if there is no departure at or after
+   *          the given time.
+   */
+  uint32_t next_departure_time(const uint32_t current_time) const;
+
   /**
    * Get the elapsed time until arrival at the next stop.
    * @return  Returns the time in seconds.
@@ -1,6 +1,7 @@
 #ifndef VALHALLA_BALDR_TRANSITSCHEDULE_H_
 #define VALHALLA_BALDR_TRANSITSCHEDULE_H_
 
+#include <cstddef>
 #include <valhalla/baldr/graphconstants.h>
 
 namespace valhalla {
@@ -57,6 +58,22 @@ class TransitSchedule {
   bool IsValid(const uint32_t day, const uint32_t dow,
                bool date_before_tile) const;
 
+  /**
+   * Checks many schedule entries at once for the specified day and day of
+   * week, the same way as IsValid. There are no branches per entry so the
+   * loop can be vectorized.
+   * @param  schedules  Schedule entries to check.
+   * @param  count      Number of schedule entries.
+   * @param  day  Days since tile creation.
+   * @param  dow  Day of week.
+   * @param  date_before_tile  Is the date prior to the tile creation date.
+   * @param  valid  Set to 1 for each valid entry, 0 otherwise. Must hold
+   *                count entries.
+   */
+  static void IsValid(const TransitSchedule* schedules, const size_t count,
+                      const uint32_t day, const uint32_t dow,
+                      bool date_before_tile, uint8_t* valid);
+
   // For sorting so we can make unique list of schedule records per tile
   bool operator < (const TransitSchedule& other) const;
 
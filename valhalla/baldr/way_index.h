@@ -0,0 +1,75 @@
+#ifndef VALHALLA_BALDR_WAY_INDEX_H_
+#define VALHALLA_BALDR_WAY_INDEX_H_
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+
+#include <vector>
+#include <cstdint>
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+  namespace baldr {
+    /**
+     * Index of OSM way Ids to the tiles that have edges on those ways. Paired
+     * with the per tile way Id index (GraphTile::GetEdgesForWay) it turns
+     * finding the edges of a way into a couple of binary searches instead of
+     * a scan over all the tiles.
+     */
+    class way_index_t {
+     public:
+      /**
+       * Constructs the way index by reading every tile in the tile set
+       * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
+       */
+      way_index_t(const boost::property_tree::ptree& pt);
+
+      /**
+       * Constructs the way index from the tiles available to a reader
+       * @param reader  the graph reader to get the tiles from
+       * @param tiles   the tiles to index
+       */
+      template <typename TileSet>
+      way_index_t(GraphReader& reader, const TileSet& tiles) {
+        for (const auto& tile_id : tiles)
+          add(reader, tile_id);
+        finish();
+      }
+
+      /**
+       * Returns the tiles that have edges on the given way
+       *
+       * @param wayid   the OSM way id
+       * @return tiles  the ids of the tiles (sorted)
+       */
+      std::vector<GraphId> tiles(const uint64_t wayid) const;
+
+      /**
+       * Returns the directed edges on the given way
+       *
+       * @param wayid   the OSM way id
+       * @param reader  the graph reader to get the tiles from
+       * @return edges  the directed edge ids
+       */
+      std::vector<GraphId> edges(const uint64_t wayid, GraphReader& reader) const;
+
+      /**
+       * Returns the number of (way, tile) pairs in the index
+       *
+       * @return size  the number of entries
+       */
+      size_t size() const;
+
+     private:
+      //add the ways of a tile to the index
+      void add(GraphReader& reader, const GraphId& tile_id);
+      //sort the index so it can be searched
+      void finish();
+
+      //sorted (way id, tile) pairs, the tile is kept as the value of its base graph id
+      std::vector<std::pair<uint64_t, uint32_t> > ways;
+    };
+  }
+}
+
+#endif //VALHALLA_BALDR_WAY_INDEX_H_